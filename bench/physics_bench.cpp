@@ -0,0 +1,366 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "game.h"
+#include "consts.h"
+#include "profiler.h"
+#include "components/mappable.h"
+#include "components/ponderable.h"
+#include "components/transformable.h"
+#include "systems/mapping.h"
+#include "systems/pondering.h"
+#include "systems/realizing.h"
+
+/**
+ * Every heap allocation made by the benchmark goes through here, so that the
+ * allocations made while ticking can be counted.
+ */
+static std::atomic<size_t> allocations(0);
+
+void* operator new(std::size_t size)
+{
+  allocations++;
+
+  void* ptr = std::malloc(size > 0 ? size : 1);
+
+  if (ptr == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+struct BenchOptions {
+  size_t ticks = 1000;
+  size_t bodies = 200;
+  size_t platforms = 10;
+  size_t passengers = 2;
+  double wallDensity = 0.1;
+  unsigned int seed = 0;
+  double tickRate = 100.0;
+  PonderingSystem::EnvironmentBackend collision =
+    PonderingSystem::EnvironmentBackend::boundaries;
+  PonderingSystem::Arithmetic arithmetic =
+    PonderingSystem::Arithmetic::floating;
+};
+
+using id_type = EntityManager::id_type;
+
+const int WALL_TILE = 1;
+const int PLATFORM_WIDTH = TILE_WIDTH * 3;
+const int PLATFORM_SPEED = 30;
+const double PLATFORM_PERIOD = 0.9;
+const int BODY_SIZE = 6;
+
+void printUsage()
+{
+  std::cerr << "Usage: physics_bench [options]" << std::endl
+    << "  --ticks N             Ticks to simulate (default 1000)" << std::endl
+    << "  --bodies N            Freefalling bodies (default 200)" << std::endl
+    << "  --platforms N         Moving platforms (default 10)" << std::endl
+    << "  --passengers N        Bodies on each platform (default 2)"
+      << std::endl
+    << "  --walls D             Fraction of tiles that are walls (default 0.1)"
+      << std::endl
+    << "  --seed N              Seed for the scene layout (default 0)"
+      << std::endl
+    << "  --tick-rate HZ        Ticks per simulated second (default 100)"
+      << std::endl
+    << "  --collision BACKEND   boundaries or tiles (default boundaries)"
+      << std::endl
+    << "  --arithmetic MODE     floating or fixed (default floating)"
+      << std::endl
+    << "Run from the repository root, so that the game's resources are found."
+      << std::endl;
+}
+
+BenchOptions parseOptions(int argc, char** argv)
+{
+  BenchOptions options;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+
+    if ((arg == "--ticks") && (i + 1 < argc))
+    {
+      options.ticks = std::stoul(argv[++i]);
+    } else if ((arg == "--bodies") && (i + 1 < argc))
+    {
+      options.bodies = std::stoul(argv[++i]);
+    } else if ((arg == "--platforms") && (i + 1 < argc))
+    {
+      options.platforms = std::stoul(argv[++i]);
+    } else if ((arg == "--passengers") && (i + 1 < argc))
+    {
+      options.passengers = std::stoul(argv[++i]);
+    } else if ((arg == "--walls") && (i + 1 < argc))
+    {
+      options.wallDensity = std::stod(argv[++i]);
+    } else if ((arg == "--seed") && (i + 1 < argc))
+    {
+      options.seed = std::stoul(argv[++i]);
+    } else if ((arg == "--tick-rate") && (i + 1 < argc))
+    {
+      options.tickRate = std::stod(argv[++i]);
+
+      if (!(options.tickRate > 0.0))
+      {
+        throw std::invalid_argument("Tick rate must be positive");
+      }
+    } else if ((arg == "--collision") && (i + 1 < argc))
+    {
+      options.collision =
+        PonderingSystem::parseEnvironmentBackend(argv[++i]);
+    } else if ((arg == "--arithmetic") && (i + 1 < argc))
+    {
+      options.arithmetic = PonderingSystem::parseArithmetic(argv[++i]);
+    } else {
+      throw std::invalid_argument("Unknown argument: " + arg);
+    }
+  }
+
+  return options;
+}
+
+/**
+ * Creates a map that is walled in on every side, with walls scattered
+ * randomly through the interior, and makes it the active map.
+ */
+id_type createMap(Game& game, std::mt19937& rng, double wallDensity)
+{
+  EntityManager& entityManager = game.getEntityManager();
+
+  id_type map = entityManager.emplaceEntity();
+
+  auto& mappable = entityManager.emplaceComponent<MappableComponent>(map,
+    Texture("res/tiles.png"),
+    Texture("res/font.bmp"));
+
+  mappable.title = "Physics benchmark";
+  mappable.tiles.resize(MAP_WIDTH * MAP_HEIGHT, 0);
+
+  std::bernoulli_distribution wallDist(wallDensity);
+
+  for (int y = 0; y < MAP_HEIGHT; y++)
+  {
+    for (int x = 0; x < MAP_WIDTH; x++)
+    {
+      bool border =
+        (x == 0) || (x == MAP_WIDTH - 1) || (y == 0) || (y == MAP_HEIGHT - 1);
+
+      if (border || wallDist(rng))
+      {
+        mappable.tiles[x + y * MAP_WIDTH] = WALL_TILE;
+      }
+    }
+  }
+
+  game.getSystemManager().getSystem<MappingSystem>().generateBoundaries(map);
+  game.getSystemManager().getSystem<RealizingSystem>().loadMap(map);
+
+  return map;
+}
+
+id_type createBody(
+  Game& game,
+  PonderableComponent::Type type,
+  vec2d pos,
+  vec2i size)
+{
+  EntityManager& entityManager = game.getEntityManager();
+
+  id_type entity = entityManager.emplaceEntity();
+
+  auto& transformable = entityManager.
+    emplaceComponent<TransformableComponent>(entity);
+
+  transformable.pos = pos;
+  transformable.size = size;
+  transformable.origPos = pos;
+  transformable.origSize = size;
+
+  auto& pondering = game.getSystemManager().getSystem<PonderingSystem>();
+  pondering.initializeBody(entity, type);
+
+  game.getSystemManager().getSystem<RealizingSystem>().enterActiveMap(entity);
+  pondering.refreshBody(entity);
+
+  return entity;
+}
+
+/**
+ * Returns the position of a random tile that isn't a wall.
+ */
+vec2d findOpenTile(
+  const MappableComponent& mappable,
+  std::mt19937& rng)
+{
+  std::uniform_int_distribution<int> xDist(1, MAP_WIDTH - 2);
+  std::uniform_int_distribution<int> yDist(1, MAP_HEIGHT - 2);
+
+  for (;;)
+  {
+    int x = xDist(rng);
+    int y = yDist(rng);
+
+    if (mappable.tiles[x + y * MAP_WIDTH] == 0)
+    {
+      return { static_cast<double>(x * TILE_WIDTH),
+        static_cast<double>(y * TILE_HEIGHT) };
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  BenchOptions options;
+
+  try
+  {
+    options = parseOptions(argc, argv);
+  } catch (const std::exception& ex)
+  {
+    std::cerr << ex.what() << std::endl;
+    printUsage();
+
+    return 1;
+  }
+
+  std::mt19937 rng(options.seed);
+
+  Game game(rng);
+
+  EntityManager& entityManager = game.getEntityManager();
+  auto& pondering = game.getSystemManager().getSystem<PonderingSystem>();
+  pondering.setEnvironmentBackend(options.collision);
+  pondering.setArithmetic(options.arithmetic);
+
+  id_type map = createMap(game, rng, options.wallDensity);
+  auto& mappable = entityManager.getComponent<MappableComponent>(map);
+
+  for (size_t i = 0; i < options.bodies; i++)
+  {
+    createBody(
+      game,
+      PonderableComponent::Type::freefalling,
+      findOpenTile(mappable, rng),
+      { BODY_SIZE, BODY_SIZE });
+  }
+
+  std::vector<id_type> platforms;
+
+  for (size_t i = 0; i < options.platforms; i++)
+  {
+    vec2d pos = findOpenTile(mappable, rng);
+
+    id_type platform = createBody(
+      game,
+      PonderableComponent::Type::vacuumed,
+      pos,
+      { PLATFORM_WIDTH, TILE_HEIGHT });
+
+    platforms.push_back(platform);
+
+    // Passengers start out resting on top of the platform, and are picked up
+    // as soon as they land on it.
+    for (size_t j = 0; j < options.passengers; j++)
+    {
+      double offset =
+        (PLATFORM_WIDTH - BODY_SIZE) * (j + 1.0) / (options.passengers + 1);
+
+      createBody(
+        game,
+        PonderableComponent::Type::freefalling,
+        { pos.x() + offset, pos.y() - BODY_SIZE },
+        { BODY_SIZE, BODY_SIZE });
+    }
+  }
+
+  Profiler profiler;
+  pondering.setProfiler(&profiler);
+
+  const double dt = 1.0 / options.tickRate;
+
+  // Platforms turn around after the same amount of simulated time whatever
+  // the tick rate, so that runs at different rates are comparable.
+  size_t platformPeriod = std::max<size_t>(
+    1,
+    std::lround(PLATFORM_PERIOD * options.tickRate));
+
+  size_t allocationsBefore = allocations;
+  auto start = std::chrono::steady_clock::now();
+
+  for (size_t tick = 0; tick < options.ticks; tick++)
+  {
+    // Platforms shuttle back and forth, like the ones driven by scripts.
+    if (tick % platformPeriod == 0)
+    {
+      double speed =
+        ((tick / platformPeriod) % 2 == 0) ? PLATFORM_SPEED : -PLATFORM_SPEED;
+
+      for (id_type platform : platforms)
+      {
+        entityManager.getComponent<PonderableComponent>(platform).vel.x() =
+          speed;
+      }
+    }
+
+    pondering.tick(dt);
+    entityManager.flushCommands();
+  }
+
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+
+  size_t allocated = allocations - allocationsBefore;
+
+  pondering.setProfiler(nullptr);
+
+  Profiler::Stats detect = profiler.getStats(0);
+  double ticks = static_cast<double>(options.ticks);
+
+  std::cout << std::fixed << std::setprecision(4)
+    << "bodies                " << options.bodies << std::endl
+    << "platforms             " << options.platforms << " x "
+      << options.passengers << " passengers" << std::endl
+    << "wall density          " << options.wallDensity << std::endl
+    << "collision backend     "
+      << PonderingSystem::getEnvironmentBackendName(options.collision)
+      << std::endl
+    << "arithmetic            "
+      << PonderingSystem::getArithmeticName(options.arithmetic) << std::endl
+    << "tick rate             " << options.tickRate << std::endl
+    << "ticks                 " << options.ticks << std::endl
+    << "elapsed s             " << elapsed.count() << std::endl
+    << "ticks/s               " << (ticks / elapsed.count()) << std::endl
+    << "detect calls/tick     " << (detect.totalCount / ticks) << std::endl
+    << "detect avg ms         "
+      << (detect.totalCount > 0 ? detect.totalTime / detect.totalCount : 0.0)
+      << std::endl
+    << "detect p99 ms         " << detect.p99
+      << " (last " << detect.count << " calls)" << std::endl
+    << "allocations/tick      " << (allocated / ticks) << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,194 @@
+#include "body_store.h"
+#include <algorithm>
+#include <cmath>
+#include "fixed_point.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Accelerates one axis of a body. The acceleration always points towards the
+ * target velocity, whatever its sign, and the velocity is clamped to the
+ * target if it would pass it.
+ */
+inline double accelerateTowards(
+  double vel,
+  double accel,
+  double targetVel,
+  double dt)
+{
+  if (vel < targetVel)
+  {
+    double effAcc = (accel < 0) ? -accel : accel;
+
+    return std::min(vel + effAcc * dt, targetVel);
+  } else if (vel > targetVel)
+  {
+    double effAcc = (accel > 0) ? -accel : accel;
+
+    return std::max(vel + effAcc * dt, targetVel);
+  }
+
+  // Adding zero normalizes a negative zero velocity, as stepping would.
+  return vel + 0.0;
+}
+
+inline fixed_type accelerateTowardsFixed(
+  fixed_type vel,
+  fixed_type accel,
+  fixed_type targetVel,
+  fixed_type dt)
+{
+  fixed_type step = scaleByTime((accel < 0) ? -accel : accel, dt);
+
+  if (vel < targetVel)
+  {
+    return std::min(vel + step, targetVel);
+  } else if (vel > targetVel)
+  {
+    return std::max(vel - step, targetVel);
+  }
+
+  return vel;
+}
+
+void BodyStore::clear()
+{
+  vel_.clear();
+  accel_.clear();
+  targetVel_.clear();
+}
+
+size_t BodyStore::add(
+  const vec2d& vel,
+  const vec2d& accel,
+  const vec2d& targetVel)
+{
+  size_t index = size();
+
+  vel_.push_back(vel.x());
+  vel_.push_back(vel.y());
+  accel_.push_back(accel.x());
+  accel_.push_back(accel.y());
+  targetVel_.push_back(targetVel.x());
+  targetVel_.push_back(targetVel.y());
+
+  return index;
+}
+
+void BodyStore::integrate(double dt)
+{
+  size_t count = vel_.size();
+  size_t i = 0;
+
+  // The min and max operands are ordered so that, like the scalar code, the
+  // stepped velocity is kept when it lands exactly on the target.
+#if defined(__AVX__)
+  const __m256d signMask = _mm256_set1_pd(-0.0);
+  const __m256d step = _mm256_set1_pd(dt);
+  const __m256d zero = _mm256_setzero_pd();
+
+  for (; i + 4 <= count; i += 4)
+  {
+    __m256d vel = _mm256_loadu_pd(&vel_[i]);
+    __m256d accel = _mm256_loadu_pd(&accel_[i]);
+    __m256d target = _mm256_loadu_pd(&targetVel_[i]);
+
+    // Flip the sign of the acceleration where it points away from the target.
+    __m256d upAcc = _mm256_xor_pd(
+      accel,
+      _mm256_and_pd(
+        _mm256_cmp_pd(accel, zero, _CMP_LT_OQ),
+        signMask));
+
+    __m256d downAcc = _mm256_xor_pd(
+      accel,
+      _mm256_and_pd(
+        _mm256_cmp_pd(accel, zero, _CMP_GT_OQ),
+        signMask));
+
+    __m256d up = _mm256_min_pd(
+      target,
+      _mm256_add_pd(vel, _mm256_mul_pd(upAcc, step)));
+
+    __m256d down = _mm256_max_pd(
+      target,
+      _mm256_add_pd(vel, _mm256_mul_pd(downAcc, step)));
+
+    __m256d result = _mm256_blendv_pd(
+      _mm256_add_pd(vel, zero),
+      up,
+      _mm256_cmp_pd(vel, target, _CMP_LT_OQ));
+
+    result = _mm256_blendv_pd(
+      result,
+      down,
+      _mm256_cmp_pd(vel, target, _CMP_GT_OQ));
+
+    _mm256_storeu_pd(&vel_[i], result);
+  }
+#elif defined(__SSE2__)
+  const __m128d signMask = _mm_set1_pd(-0.0);
+  const __m128d step = _mm_set1_pd(dt);
+  const __m128d zero = _mm_setzero_pd();
+
+  for (; i + 2 <= count; i += 2)
+  {
+    __m128d vel = _mm_loadu_pd(&vel_[i]);
+    __m128d accel = _mm_loadu_pd(&accel_[i]);
+    __m128d target = _mm_loadu_pd(&targetVel_[i]);
+
+    // Flip the sign of the acceleration where it points away from the target.
+    __m128d upAcc = _mm_xor_pd(
+      accel,
+      _mm_and_pd(_mm_cmplt_pd(accel, zero), signMask));
+
+    __m128d downAcc = _mm_xor_pd(
+      accel,
+      _mm_and_pd(_mm_cmpgt_pd(accel, zero), signMask));
+
+    __m128d up = _mm_min_pd(
+      target,
+      _mm_add_pd(vel, _mm_mul_pd(upAcc, step)));
+
+    __m128d down = _mm_max_pd(
+      target,
+      _mm_add_pd(vel, _mm_mul_pd(downAcc, step)));
+
+    __m128d below = _mm_cmplt_pd(vel, target);
+    __m128d above = _mm_cmpgt_pd(vel, target);
+
+    // SSE2 has no blend instruction, so select with masks.
+    __m128d result = _mm_or_pd(
+      _mm_or_pd(_mm_and_pd(below, up), _mm_and_pd(above, down)),
+      _mm_andnot_pd(
+        _mm_or_pd(below, above),
+        _mm_add_pd(vel, zero)));
+
+    _mm_storeu_pd(&vel_[i], result);
+  }
+#endif
+
+  for (; i < count; i++)
+  {
+    vel_[i] = accelerateTowards(vel_[i], accel_[i], targetVel_[i], dt);
+  }
+}
+
+void BodyStore::integrateFixed(double dt)
+{
+  fixed_type fixedDt = toFixedTime(dt);
+
+  for (size_t i = 0; i < vel_.size(); i++)
+  {
+    vel_[i] = fromFixed(
+      accelerateTowardsFixed(
+        toFixed(vel_[i]),
+        toFixed(accel_[i]),
+        toFixed(targetVel_[i]),
+        fixedDt));
+  }
+}
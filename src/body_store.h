@@ -0,0 +1,59 @@
+#ifndef BODY_STORE_H_3E8B61D4
+#define BODY_STORE_H_3E8B61D4
+
+#include <vector>
+#include <cstddef>
+#include "vector.h"
+
+/**
+ * Structure-of-arrays storage for the motion state of the bodies that are
+ * being simulated in a tick, so that their velocities can be integrated in a
+ * single pass over contiguous memory.
+ *
+ * The x and y components of each field are interleaved, so both axes of a
+ * body are integrated by the same vector instruction. The components remain
+ * the authoritative copy of the state; the store is filled from them at the
+ * start of a tick and the results are copied back.
+ */
+class BodyStore {
+public:
+
+  void clear();
+
+  /**
+   * Adds a body to the store, and returns its index.
+   */
+  size_t add(const vec2d& vel, const vec2d& accel, const vec2d& targetVel);
+
+  inline size_t size() const
+  {
+    return vel_.size() / 2;
+  }
+
+  inline vec2d getVelocity(size_t index) const
+  {
+    return { vel_[index * 2], vel_[index * 2 + 1] };
+  }
+
+  /**
+   * Accelerates every body towards its target velocity, without overshooting
+   * it. This uses AVX or SSE2 when the compiler targets them, and scalar code
+   * otherwise; all of them produce the same results.
+   */
+  void integrate(double dt);
+
+  /**
+   * Does the same as integrate, but with 16.16 fixed-point arithmetic, so
+   * that the results don't depend on how the game was compiled. The bodies'
+   * motion state must already be on the fixed-point grid.
+   */
+  void integrateFixed(double dt);
+
+private:
+
+  std::vector<double> vel_;
+  std::vector<double> accel_;
+  std::vector<double> targetVel_;
+};
+
+#endif /* end of include guard: BODY_STORE_H_3E8B61D4 */
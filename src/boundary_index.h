@@ -0,0 +1,146 @@
+#ifndef BOUNDARY_INDEX_H_8D4F2A6C
+#define BOUNDARY_INDEX_H_8D4F2A6C
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include "components/ponderable.h"
+
+/**
+ * A sorted collection of collision boundaries that face one direction. Each
+ * boundary is a line segment perpendicular to the direction of movement: it is
+ * located at a point on the axis of movement, and spans a range on the other
+ * axis.
+ *
+ * Boundaries are stored as parallel arrays sorted by axis according to
+ * Compare, so that a sweep can binary search for its starting point and then
+ * scan the non-axis ranges of consecutive boundaries without chasing pointers.
+ * Boundaries with equal axes are kept in the order they were added.
+ */
+template <class Compare>
+class BoundaryIndex {
+public:
+
+  using Type = PonderableComponent::Collision;
+
+  void add(double axis, double lower, double upper, Type type)
+  {
+    size_t index = upperBound(axis);
+
+    axes_.insert(std::begin(axes_) + index, axis);
+    lowers_.insert(std::begin(lowers_) + index, lower);
+    uppers_.insert(std::begin(uppers_) + index, upper);
+    types_.insert(std::begin(types_) + index, type);
+  }
+
+  void clear()
+  {
+    axes_.clear();
+    lowers_.clear();
+    uppers_.clear();
+    types_.clear();
+  }
+
+  inline size_t size() const
+  {
+    return axes_.size();
+  }
+
+  inline double getAxis(size_t index) const
+  {
+    return axes_[index];
+  }
+
+  inline double getLower(size_t index) const
+  {
+    return lowers_[index];
+  }
+
+  inline double getUpper(size_t index) const
+  {
+    return uppers_[index];
+  }
+
+  inline Type getType(size_t index) const
+  {
+    return types_[index];
+  }
+
+  /**
+   * Returns the index of the first boundary that is not ordered before the
+   * given axis.
+   */
+  inline size_t lowerBound(double axis) const
+  {
+    return std::distance(
+      std::begin(axes_),
+      std::lower_bound(std::begin(axes_), std::end(axes_), axis, Compare()));
+  }
+
+  /**
+   * Returns the index of the first boundary that is ordered after the given
+   * axis.
+   */
+  inline size_t upperBound(double axis) const
+  {
+    return std::distance(
+      std::begin(axes_),
+      std::upper_bound(std::begin(axes_), std::end(axes_), axis, Compare()));
+  }
+
+  /**
+   * Returns the index of the first boundary in [first, last) whose non-axis
+   * range overlaps the open range (lower, upper), or last if there is none.
+   */
+  size_t findOverlap(
+    size_t first,
+    size_t last,
+    double lower,
+    double upper) const
+  {
+    const size_t BLOCK = 4;
+
+    // Test a block of boundaries at a time without branching, so that the
+    // comparisons can be vectorized.
+    for (; first + BLOCK <= last; first += BLOCK)
+    {
+      unsigned int mask = 0;
+
+      for (size_t i = 0; i < BLOCK; i++)
+      {
+        mask |= static_cast<unsigned int>(
+          (upper > lowers_[first + i]) & (lower < uppers_[first + i])) << i;
+      }
+
+      if (mask != 0)
+      {
+        for (size_t i = 0; ; i++)
+        {
+          if (mask & (1u << i))
+          {
+            return first + i;
+          }
+        }
+      }
+    }
+
+    for (; first < last; first++)
+    {
+      if ((upper > lowers_[first]) && (lower < uppers_[first]))
+      {
+        return first;
+      }
+    }
+
+    return last;
+  }
+
+private:
+
+  std::vector<double> axes_;
+  std::vector<double> lowers_;
+  std::vector<double> uppers_;
+  std::vector<Type> types_;
+};
+
+#endif /* end of include guard: BOUNDARY_INDEX_H_8D4F2A6C */
@@ -0,0 +1,192 @@
+#ifndef COMPONENT_POOL_H_7A1C93E4
+#define COMPONENT_POOL_H_7A1C93E4
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <stdexcept>
+#include <limits>
+#include "entity_handle.h"
+
+/**
+ * Type-erased interface to a component pool, so that the entity manager can
+ * query and destroy components without knowing their concrete type.
+ */
+class BaseComponentPool {
+public:
+
+  using id_type = EntityHandle::id_type;
+
+  virtual ~BaseComponentPool() = default;
+
+  inline bool contains(id_type entity) const
+  {
+    EntityHandle::index_type index = EntityHandle::getIndex(entity);
+
+    return (index < sparse_.size()) && (sparse_[index] != npos);
+  }
+
+  inline size_t size() const
+  {
+    return dense_.size();
+  }
+
+  /**
+   * The entities that own a component in this pool, in the same order as the
+   * components themselves are stored.
+   */
+  inline const std::vector<id_type>& getEntities() const
+  {
+    return dense_;
+  }
+
+  virtual void remove(id_type entity) = 0;
+
+protected:
+
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  /**
+   * Maps an entity's slot index to the index of its component in the dense
+   * storage, or npos if the entity does not have a component in this pool.
+   */
+  std::vector<size_t> sparse_;
+
+  /**
+   * Maps an index in the dense storage to the entity that owns it.
+   */
+  std::vector<id_type> dense_;
+};
+
+/**
+ * Sparse set storage for a single component type. Components are stored
+ * contiguously in fixed-size pages, so iterating over the pool walks dense
+ * arrays, and growing the pool never moves existing components.
+ *
+ * Removing a component moves the last component in the pool into the hole it
+ * leaves behind, so references to components of a given type are invalidated
+ * when a component of that type is removed.
+ */
+template <class T>
+class ComponentPool : public BaseComponentPool {
+public:
+
+  static constexpr size_t PAGE_SIZE = 128;
+
+  ComponentPool() = default;
+
+  ComponentPool(const ComponentPool& copy) = delete;
+
+  ~ComponentPool()
+  {
+    for (size_t i = 0; i < dense_.size(); i++)
+    {
+      at(i).~T();
+    }
+  }
+
+  template <class... Args>
+  T& emplace(id_type entity, Args&&... args)
+  {
+    if (contains(entity))
+    {
+      throw std::invalid_argument("Cannot emplace already-existent component");
+    }
+
+    size_t index = dense_.size();
+
+    if (index / PAGE_SIZE >= pages_.size())
+    {
+      pages_.emplace_back(new page_type);
+    }
+
+    T* component = new (slot(index)) T(std::forward<Args>(args)...);
+
+    EntityHandle::index_type entitySlot = EntityHandle::getIndex(entity);
+
+    if (entitySlot >= sparse_.size())
+    {
+      sparse_.resize(entitySlot + 1, npos);
+    }
+
+    sparse_[entitySlot] = index;
+    dense_.push_back(entity);
+
+    return *component;
+  }
+
+  void remove(id_type entity) override
+  {
+    if (!contains(entity))
+    {
+      throw std::invalid_argument("Cannot delete non-existent component");
+    }
+
+    EntityHandle::index_type entitySlot = EntityHandle::getIndex(entity);
+    size_t index = sparse_[entitySlot];
+    size_t last = dense_.size() - 1;
+
+    // Fill the hole with the last component so the storage stays dense.
+    if (index != last)
+    {
+      at(index).~T();
+      new (slot(index)) T(std::move(at(last)));
+
+      dense_[index] = dense_[last];
+      sparse_[EntityHandle::getIndex(dense_[index])] = index;
+    }
+
+    at(last).~T();
+    dense_.pop_back();
+    sparse_[entitySlot] = npos;
+  }
+
+  inline const T& get(id_type entity) const
+  {
+    if (!contains(entity))
+    {
+      throw std::invalid_argument("Cannot get non-existent component");
+    }
+
+    return at(sparse_[EntityHandle::getIndex(entity)]);
+  }
+
+  inline T& get(id_type entity)
+  {
+    return const_cast<T&>(
+      static_cast<const ComponentPool&>(*this).get(entity));
+  }
+
+  /**
+   * Direct access to a component by its index in the dense storage.
+   */
+  inline const T& at(size_t index) const
+  {
+    return *reinterpret_cast<const T*>(
+      &pages_[index / PAGE_SIZE]->slots[index % PAGE_SIZE]);
+  }
+
+  inline T& at(size_t index)
+  {
+    return *reinterpret_cast<T*>(slot(index));
+  }
+
+private:
+
+  using storage_type =
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+  struct page_type {
+    storage_type slots[PAGE_SIZE];
+  };
+
+  inline void* slot(size_t index)
+  {
+    return &pages_[index / PAGE_SIZE]->slots[index % PAGE_SIZE];
+  }
+
+  std::vector<std::unique_ptr<page_type>> pages_;
+};
+
+#endif /* end of include guard: COMPONENT_POOL_H_7A1C93E4 */
@@ -1,7 +1,6 @@
 #ifndef MAPPABLE_H_0B0316FB
 #define MAPPABLE_H_0B0316FB
 
-#include <map>
 #include <string>
 #include <vector>
 #include <list>
@@ -9,6 +8,8 @@
 #include "renderer/texture.h"
 #include "components/ponderable.h"
 #include "entity_manager.h"
+#include "boundary_index.h"
+#include "tile_collision_grid.h"
 
 class MappableComponent : public Component {
 public:
@@ -40,46 +41,11 @@ public:
     size_t mapId;
   };
 
-  /**
-   * Helper type that stores information about collision boundaries.
-   */
-  class Boundary {
-  public:
-
-    using Type = PonderableComponent::Collision;
-
-    Boundary(
-      double axis,
-      double lower,
-      double upper,
-      Type type) :
-        axis(axis),
-        lower(lower),
-        upper(upper),
-        type(type)
-    {
-    }
-
-    double axis;
-    double lower;
-    double upper;
-    Type type;
-  };
-
   /**
    * Helper types for efficient storage and lookup of collision boundaries.
    */
-  using asc_boundaries_type =
-    std::multimap<
-      double,
-      const Boundary,
-      std::less<double>>;
-
-  using desc_boundaries_type =
-    std::multimap<
-      double,
-      const Boundary,
-      std::greater<double>>;
+  using asc_boundaries_type = BoundaryIndex<std::less<double>>;
+  using desc_boundaries_type = BoundaryIndex<std::greater<double>>;
 
   /**
    * Constructor for initializing the tileset and font attributes, as they are
@@ -133,6 +99,13 @@ public:
   desc_boundaries_type upBoundaries;
   asc_boundaries_type downBoundaries;
 
+  /**
+   * The same boundaries, stored per tile, for the tile grid collision backend.
+   *
+   * @managed_by MappingSystem
+   */
+  TileCollisionGrid collisionGrid;
+
   /**
    * The list of entities representing the objects owned by the map.
    *
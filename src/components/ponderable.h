@@ -38,6 +38,27 @@ public:
     event
   };
 
+  using layer_type = unsigned int;
+
+  /**
+   * Collision layers, as bit flags. A body belongs to the layers in its layer
+   * field, and only collides with bodies on the layers in its mask. Both
+   * bodies of a pair have to accept each other.
+   *
+   * body      - Default. Bodies that aren't on any more specific layer.
+   * player    - Bodies controlled by the player.
+   * platform  - Bodies that other bodies can stand on or be blocked by.
+   * trigger   - Bodies that only exist to be touched, such as checkpoints.
+   */
+  struct Layer {
+    static constexpr layer_type none = 0;
+    static constexpr layer_type body = 1 << 0;
+    static constexpr layer_type player = 1 << 1;
+    static constexpr layer_type platform = 1 << 2;
+    static constexpr layer_type trigger = 1 << 3;
+    static constexpr layer_type all = ~0u;
+  };
+
   /**
    * Constructor for initializing the body type, which is a constant.
    */
@@ -124,6 +145,34 @@ public:
    */
   Collision colliderType = Collision::wall;
 
+  /**
+   * The collision layers that this body belongs to.
+   */
+  layer_type layer = Layer::body;
+
+  /**
+   * The collision layers that this body collides with.
+   */
+  layer_type mask = Layer::all;
+
+  /**
+   * Returns whether the layers of two bodies allow them to collide. This is
+   * cheap enough to check before any geometry.
+   */
+  inline bool canCollideWith(const PonderableComponent& other) const
+  {
+    return ((mask & other.layer) != 0) && ((other.mask & layer) != 0);
+  }
+
+  /**
+   * Whether the body has been at rest for long enough that the pondering
+   * system has stopped simulating it. It still collides with other bodies.
+   * See PonderingSystem::wakeBody.
+   *
+   * @managed_by PonderingSystem
+   */
+  bool asleep = false;
+
   /**
    * If this flag is disabled, the entity will be ignored by the pondering
    * system.
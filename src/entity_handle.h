@@ -0,0 +1,45 @@
+#ifndef ENTITY_HANDLE_H_93D0F6A2
+#define ENTITY_HANDLE_H_93D0F6A2
+
+#include <cstdint>
+
+/**
+ * Helpers for packing and unpacking entity handles. A handle is a 64-bit value
+ * whose upper 32 bits are the index of the entity's slot in the entity manager
+ * and whose lower 32 bits are the generation of that slot. The generation is
+ * incremented whenever a slot is freed, so a handle to a deleted entity can be
+ * told apart from a handle to a new entity that reuses the same slot.
+ *
+ * The index occupies the upper bits so that ordering handles orders entities by
+ * slot.
+ */
+class EntityHandle {
+public:
+
+  using id_type = uint64_t;
+  using index_type = uint32_t;
+  using generation_type = uint32_t;
+
+  /**
+   * A handle that never refers to an entity, because its slot index is past
+   * any that the entity manager will allocate.
+   */
+  static constexpr id_type none = ~static_cast<id_type>(0);
+
+  static inline id_type make(index_type index, generation_type generation)
+  {
+    return (static_cast<id_type>(index) << 32) | generation;
+  }
+
+  static inline index_type getIndex(id_type entity)
+  {
+    return static_cast<index_type>(entity >> 32);
+  }
+
+  static inline generation_type getGeneration(id_type entity)
+  {
+    return static_cast<generation_type>(entity & 0xFFFFFFFF);
+  }
+};
+
+#endif /* end of include guard: ENTITY_HANDLE_H_93D0F6A2 */
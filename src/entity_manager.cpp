@@ -3,37 +3,98 @@
 
 #include "entity_manager.h"
 
-template <>
-std::set<EntityManager::id_type> EntityManager::getEntitiesWithComponents<>(
-  std::set<std::type_index>& componentTypes) const
+const std::vector<EntityManager::id_type>&
+  EntityManager::getEntitiesWithSignature(
+    const signature_type& signature) const
 {
-  if (cachedComponents.count(componentTypes) == 1)
+  std::lock_guard<std::mutex> lock(cacheMutex);
+
+  auto it = cachedComponents.find(signature);
+  if (it != std::end(cachedComponents))
   {
-    return cachedComponents[componentTypes];
+    return it->second;
   }
 
-  std::set<id_type>& cache = cachedComponents[componentTypes];
-  for (id_type entity = 0; entity < entities.size(); entity++)
+  std::vector<id_type>& cache = cachedComponents[signature];
+
+  // Only the entities in the smallest of the relevant pools can possibly have
+  // all of the requested components, so scan that pool and check signatures.
+  const BaseComponentPool* smallest = nullptr;
+
+  for (component_id_type componentType = 0;
+    componentType < MAX_COMPONENT_TYPES;
+    componentType++)
   {
-    const EntityData& data = entities[entity];
-    bool cacheEntity = true;
+    if (!signature.test(componentType))
+    {
+      continue;
+    }
 
-    for (auto& componentType : componentTypes)
+    const BaseComponentPool* pool = getPool(componentType);
+    if (pool == nullptr)
     {
-      if (data.components.count(componentType) == 0)
-      {
-        cacheEntity = false;
-        break;
-      }
+      return cache;
+    }
+
+    if ((smallest == nullptr) || (pool->size() < smallest->size()))
+    {
+      smallest = pool;
     }
+  }
+
+  if (smallest == nullptr)
+  {
+    return cache;
+  }
+
+  for (id_type entity : smallest->getEntities())
+  {
+    const signature_type& entitySignature =
+      signatures[EntityHandle::getIndex(entity)];
 
-    if (cacheEntity)
+    if ((entitySignature & signature) == signature)
     {
-      cache.insert(entity);
+      cache.push_back(entity);
     }
   }
 
+  std::sort(std::begin(cache), std::end(cache));
+
   return cache;
 }
 
+void EntityManager::updateCaches(
+  id_type entity,
+  const signature_type& oldSignature,
+  const signature_type& newSignature)
+{
+  for (auto& cache : cachedComponents)
+  {
+    const signature_type& query = cache.first;
+
+    bool oldMatch = ((oldSignature & query) == query);
+    bool newMatch = ((newSignature & query) == query);
+
+    std::vector<id_type>& entities = cache.second;
+
+    if (oldMatch && !newMatch)
+    {
+      auto it = std::lower_bound(
+        std::begin(entities),
+        std::end(entities),
+        entity);
+
+      if ((it != std::end(entities)) && (*it == entity))
+      {
+        entities.erase(it);
+      }
+    } else if (!oldMatch && newMatch)
+    {
+      entities.insert(
+        std::lower_bound(std::begin(entities), std::end(entities), entity),
+        entity);
+    }
+  }
+}
+
 #endif /* end of include guard: ENTITY_MANAGER_CPP_42D78C22 */
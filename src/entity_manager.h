@@ -1,141 +1,286 @@
 #ifndef ENTITY_MANAGER_H_C5832F11
 #define ENTITY_MANAGER_H_C5832F11
 
-#include <map>
+#include <unordered_map>
 #include <vector>
-#include <typeindex>
+#include <memory>
+#include <bitset>
 #include <set>
+#include <algorithm>
+#include <tuple>
+#include <functional>
+#include <mutex>
 #include <stdexcept>
+#include <limits>
 #include "component.h"
+#include "component_pool.h"
+#include "entity_handle.h"
+#include "type_family.h"
 #include "util.h"
 
 class EntityManager {
-private:
+public:
 
-  struct EntityData {
-    std::map<std::type_index, std::unique_ptr<Component>> components;
-  };
+  using id_type = BaseComponentPool::id_type;
 
-  using database_type = std::vector<EntityData>;
+  using ComponentFamily = TypeFamily<Component>;
+  using component_id_type = ComponentFamily::id_type;
 
-public:
+  static constexpr size_t MAX_COMPONENT_TYPES = 64;
 
-  using id_type = database_type::size_type;
+  /**
+   * A bitmask with one bit per component type, used to describe both the
+   * components an entity has and the components a query requires.
+   */
+  using signature_type = std::bitset<MAX_COMPONENT_TYPES>;
 
 private:
 
-  database_type entities;
-  std::vector<bool> slotAvailable;
-  std::set<id_type> allEntities;
-
-  mutable std::map<std::set<std::type_index>, std::set<id_type>>
+  /**
+   * Each component type is stored in its own pool, indexed by the family ID of
+   * the component type. Component types that have never been emplaced have a
+   * null pool.
+   */
+  std::vector<std::unique_ptr<BaseComponentPool>> pools;
+
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  /**
+   * The current generation of each slot. A handle is only valid if its
+   * generation matches the generation of its slot.
+   */
+  std::vector<EntityHandle::generation_type> generations;
+
+  /**
+   * The position of each slot's entity in aliveEntities, or npos if the slot is
+   * not in use.
+   */
+  std::vector<size_t> aliveIndex;
+
+  /**
+   * Densely packed handles of every living entity, in no particular order.
+   */
+  std::vector<id_type> aliveEntities;
+
+  /**
+   * Slots that are available for reuse.
+   */
+  std::vector<EntityHandle::index_type> freeSlots;
+
+  /**
+   * The set of components that each entity has, indexed by slot.
+   */
+  std::vector<signature_type> signatures;
+
+  /**
+   * Query results, keyed by the signature of the query. Once a query has been
+   * made, its result is kept up to date as components are added and removed,
+   * rather than being rebuilt. Each result is a sorted vector, so that
+   * iterating over it walks contiguous memory in handle order.
+   */
+  mutable std::unordered_map<signature_type, std::vector<id_type>>
     cachedComponents;
 
-  id_type nextEntityID = 0;
+  /**
+   * Structural changes that have been deferred until the next flush.
+   */
+  std::vector<std::function<void()>> commands;
 
-  template <class T, class... R>
-  std::set<id_type> getEntitiesWithComponentsHelper(
-    std::set<std::type_index>& componentTypes) const
+  /**
+   * Systems that tick concurrently may make queries and record commands at the
+   * same time, so these are guarded.
+   */
+  mutable std::mutex cacheMutex;
+  std::mutex commandMutex;
+
+  void recordCommand(std::function<void()> command)
   {
-    componentTypes.insert(typeid(T));
+    std::lock_guard<std::mutex> lock(commandMutex);
 
-    return getEntitiesWithComponents<R...>(componentTypes);
+    commands.push_back(std::move(command));
   }
 
-  template <class... R>
-  std::set<id_type> getEntitiesWithComponents(
-    std::set<std::type_index>& componentTypes) const
+  const std::vector<id_type>& getEntitiesWithSignature(
+    const signature_type& signature) const;
+
+  /**
+   * Updates the cached queries that are affected by an entity's signature
+   * changing from one value to another.
+   */
+  void updateCaches(
+    id_type entity,
+    const signature_type& oldSignature,
+    const signature_type& newSignature);
+
+  inline void checkEntity(id_type entity) const
+  {
+    if (!isValid(entity))
+    {
+      throw std::invalid_argument("Cannot get non-existent entity");
+    }
+  }
+
+  inline const BaseComponentPool* getPool(
+    component_id_type componentType) const
+  {
+    if (componentType >= pools.size())
+    {
+      return nullptr;
+    }
+
+    return pools[componentType].get();
+  }
+
+  template <class T>
+  const ComponentPool<T>* getPool() const
   {
-    return getEntitiesWithComponentsHelper<R...>(componentTypes);
+    return static_cast<const ComponentPool<T>*>(
+      getPool(ComponentFamily::getId<T>()));
+  }
+
+  template <class T>
+  ComponentPool<T>* getPool()
+  {
+    return const_cast<ComponentPool<T>*>(
+      static_cast<const EntityManager&>(*this).getPool<T>());
+  }
+
+  template <class T>
+  ComponentPool<T>& getOrCreatePool()
+  {
+    component_id_type componentType = ComponentFamily::getId<T>();
+
+    if (componentType >= MAX_COMPONENT_TYPES)
+    {
+      throw std::logic_error("Too many component types");
+    }
+
+    if (componentType >= pools.size())
+    {
+      pools.resize(componentType + 1);
+    }
+
+    std::unique_ptr<BaseComponentPool>& pool = pools[componentType];
+
+    if (!pool)
+    {
+      pool.reset(new ComponentPool<T>());
+    }
+
+    return static_cast<ComponentPool<T>&>(*pool);
   }
 
 public:
 
+  /**
+   * Returns the signature matching exactly the given component types.
+   */
+  template <class... R>
+  static signature_type getSignature()
+  {
+    signature_type signature;
+    (signature.set(ComponentFamily::getId<R>()), ...);
+
+    return signature;
+  }
+
   EntityManager() = default;
 
   EntityManager(const EntityManager& copy) = delete;
 
   id_type emplaceEntity()
   {
-    if (nextEntityID >= entities.size())
+    EntityHandle::index_type slot;
+
+    if (freeSlots.empty())
     {
       // If the database is saturated, add a new element for the new entity.
-      entities.emplace_back();
-      slotAvailable.push_back(false);
-      allEntities.insert(nextEntityID);
-
-      return nextEntityID++;
+      slot = static_cast<EntityHandle::index_type>(generations.size());
+      generations.push_back(0);
+      aliveIndex.push_back(npos);
+      signatures.emplace_back();
     } else {
       // If there is an available slot in the database, use it.
-      id_type id = nextEntityID++;
-      slotAvailable[id] = false;
-      allEntities.insert(id);
+      slot = freeSlots.back();
+      freeSlots.pop_back();
+    }
 
-      // Fast forward the next available slot pointer to an available slot.
-      while ((nextEntityID < entities.size()) && !slotAvailable[nextEntityID])
-      {
-        nextEntityID++;
-      }
+    id_type id = EntityHandle::make(slot, generations[slot]);
 
-      return id;
-    }
+    aliveIndex[slot] = aliveEntities.size();
+    aliveEntities.push_back(id);
+
+    return id;
   }
 
   void deleteEntity(id_type entity)
   {
-    if ((entity >= entities.size()) || slotAvailable[entity])
+    if (!isValid(entity))
     {
       throw std::invalid_argument("Cannot delete non-existent entity");
     }
 
+    EntityHandle::index_type slot = EntityHandle::getIndex(entity);
+
     // Uncache components
-    for (auto& cache : cachedComponents)
+    updateCaches(entity, signatures[slot], {});
+    signatures[slot].reset();
+
+    // Destroy the data
+    for (auto& pool : pools)
     {
-      cache.second.erase(entity);
+      if (pool && pool->contains(entity))
+      {
+        pool->remove(entity);
+      }
     }
 
-    allEntities.erase(entity);
+    // Remove the entity from the list of living entities
+    size_t index = aliveIndex[slot];
+    id_type last = aliveEntities.back();
 
-    // Destroy the data
-    entities[entity].components.clear();
+    aliveEntities[index] = last;
+    aliveIndex[EntityHandle::getIndex(last)] = index;
+    aliveEntities.pop_back();
+    aliveIndex[slot] = npos;
 
-    // Mark the slot as available
-    slotAvailable[entity] = true;
+    // Mark the slot as available, and invalidate any outstanding handles to it
+    generations[slot]++;
+    freeSlots.push_back(slot);
+  }
 
-    if (entity < nextEntityID)
-    {
-      nextEntityID = entity;
-    }
+  /**
+   * Returns whether the handle refers to an entity that still exists. Handles
+   * to deleted entities stay invalid even if their slot is reused.
+   */
+  inline bool isValid(id_type entity) const
+  {
+    EntityHandle::index_type slot = EntityHandle::getIndex(entity);
+
+    return (slot < generations.size()) &&
+      (aliveIndex[slot] != npos) &&
+      (generations[slot] == EntityHandle::getGeneration(entity));
   }
 
+  /**
+   * Creates a component of the given type for an entity. Components of the
+   * same type are stored contiguously, and the returned reference stays valid
+   * until a component of the same type is removed from any entity.
+   */
   template <class T, class... Args>
   T& emplaceComponent(id_type entity, Args&&... args)
   {
-    if ((entity >= entities.size()) || slotAvailable[entity])
-    {
-      throw std::invalid_argument("Cannot get non-existent entity");
-    }
-
-    EntityData& data = entities[entity];
-    std::type_index componentType = typeid(T);
-
-    if (data.components.count(componentType))
-    {
-      throw std::invalid_argument("Cannot emplace already-existent component");
-    }
+    checkEntity(entity);
 
     // Initialize the component
-    std::unique_ptr<T> ptr(new T(std::forward<Args>(args)...));
-    T& component = *ptr;
-    data.components[componentType] = std::move(ptr);
-
-    // Invalidate related caches
-    erase_if(
-      cachedComponents,
-      [&componentType] (
-        std::pair<const std::set<std::type_index>, std::set<id_type>>& cache) {
-          return cache.first.count(componentType) == 1;
-        });
+    T& component = getOrCreatePool<T>().
+      emplace(entity, std::forward<Args>(args)...);
+
+    // Cache the component
+    signature_type& signature = signatures[EntityHandle::getIndex(entity)];
+    signature_type oldSignature = signature;
+    signature.set(ComponentFamily::getId<T>());
+    updateCaches(entity, oldSignature, signature);
 
     return component;
   }
@@ -143,49 +288,38 @@ public:
   template <class T>
   void removeComponent(id_type entity)
   {
-    if ((entity >= entities.size()) || slotAvailable[entity])
-    {
-      throw std::invalid_argument("Cannot get non-existent entity");
-    }
+    checkEntity(entity);
 
-    EntityData& data = entities[entity];
-    std::type_index componentType = typeid(T);
+    ComponentPool<T>* pool = getPool<T>();
 
-    if (!data.components.count(componentType))
+    if ((pool == nullptr) || !pool->contains(entity))
     {
       throw std::invalid_argument("Cannot delete non-existent component");
     }
 
     // Destroy the component
-    data.components.erase(componentType);
+    pool->remove(entity);
 
     // Uncache the component
-    for (auto& cache : cachedComponents)
-    {
-      if (cache.first.count(componentType) == 1)
-      {
-        cache.second.erase(entity);
-      }
-    }
+    signature_type& signature = signatures[EntityHandle::getIndex(entity)];
+    signature_type oldSignature = signature;
+    signature.reset(ComponentFamily::getId<T>());
+    updateCaches(entity, oldSignature, signature);
   }
 
   template <class T>
   const T& getComponent(id_type entity) const
   {
-    if ((entity >= entities.size()) || slotAvailable[entity])
-    {
-      throw std::invalid_argument("Cannot get non-existent entity");
-    }
+    checkEntity(entity);
 
-    const EntityData& data = entities[entity];
-    std::type_index componentType = typeid(T);
+    const ComponentPool<T>* pool = getPool<T>();
 
-    if (!data.components.count(componentType))
+    if (pool == nullptr)
     {
       throw std::invalid_argument("Cannot get non-existent component");
     }
 
-    return *dynamic_cast<const T*>(data.components.at(componentType).get());
+    return pool->get(entity);
   }
 
   template <class T>
@@ -198,33 +332,119 @@ public:
   template <class T>
   bool hasComponent(id_type entity) const
   {
-    if ((entity >= entities.size()) || slotAvailable[entity])
+    checkEntity(entity);
+
+    return signatures[EntityHandle::getIndex(entity)].
+      test(ComponentFamily::getId<T>());
+  }
+
+  template <class... R>
+  std::set<id_type> getEntitiesWithComponents() const
+  {
+    const std::vector<id_type>& entities =
+      getEntitiesWithSignature(getSignature<R...>());
+
+    return std::set<id_type>(std::begin(entities), std::end(entities));
+  }
+
+  /**
+   * Calls a function for every entity that has all of the given components,
+   * passing the entity ID followed by a reference to each of the components,
+   * in handle order. This walks the cached query result, which is a sorted
+   * vector, directly rather than copying it, so the function must not add or
+   * remove the queried component types or delete entities. Use
+   * getEntitiesWithComponents for loops that do.
+   */
+  template <class... R, class F>
+  void each(F&& fn)
+  {
+    const std::vector<id_type>& entities =
+      getEntitiesWithSignature(getSignature<R...>());
+
+    if (entities.empty())
     {
-      throw std::invalid_argument("Cannot get non-existent entity");
+      return;
     }
 
-    const EntityData& data = entities[entity];
-    std::type_index componentType = typeid(T);
+    std::tuple<ComponentPool<R>*...> componentPools { getPool<R>()... };
 
-    return data.components.count(componentType);
+    for (id_type entity : entities)
+    {
+      fn(entity, std::get<ComponentPool<R>*>(componentPools)->get(entity)...);
+    }
   }
 
-  template <class... R>
-  std::set<id_type> getEntitiesWithComponents() const
+  const std::vector<id_type>& getEntities() const
   {
-    std::set<std::type_index> componentTypes;
+    return aliveEntities;
+  }
 
-    return getEntitiesWithComponentsHelper<R...>(componentTypes);
+  /**
+   * Records that an entity should be deleted the next time commands are
+   * flushed. Use this instead of deleteEntity while iterating over entities.
+   * The command is ignored if the entity no longer exists when it is flushed.
+   */
+  void deferDeleteEntity(id_type entity)
+  {
+    recordCommand([this, entity] () {
+      if (isValid(entity))
+      {
+        deleteEntity(entity);
+      }
+    });
   }
 
-  const std::set<id_type>& getEntities() const
+  /**
+   * Records that a component should be created the next time commands are
+   * flushed. The arguments are copied until then. The command is ignored if
+   * the entity no longer exists or already has the component when it is
+   * flushed.
+   */
+  template <class T, class... Args>
+  void deferEmplaceComponent(id_type entity, Args... args)
   {
-    return allEntities;
+    recordCommand([this, entity, args...] () {
+      if (isValid(entity) && !hasComponent<T>(entity))
+      {
+        emplaceComponent<T>(entity, args...);
+      }
+    });
   }
-};
 
-template <>
-std::set<EntityManager::id_type> EntityManager::getEntitiesWithComponents<>(
-  std::set<std::type_index>& componentTypes) const;
+  /**
+   * Records that a component should be removed the next time commands are
+   * flushed. The command is ignored if the entity no longer exists or no
+   * longer has the component when it is flushed.
+   */
+  template <class T>
+  void deferRemoveComponent(id_type entity)
+  {
+    recordCommand([this, entity] () {
+      if (isValid(entity) && hasComponent<T>(entity))
+      {
+        removeComponent<T>(entity);
+      }
+    });
+  }
+
+  /**
+   * Applies all deferred commands in the order they were recorded. This is
+   * called by the SystemManager between systems.
+   */
+  void flushCommands()
+  {
+    // Commands may record further commands, which are run in the same flush.
+    while (!commands.empty())
+    {
+      std::vector<std::function<void()>> pending;
+      std::swap(pending, commands);
+
+      for (auto& command : pending)
+      {
+        command();
+      }
+    }
+  }
+};
 
 #endif /* end of include guard: ENTITY_MANAGER_H_C5832F11 */
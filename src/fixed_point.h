@@ -0,0 +1,96 @@
+#ifndef FIXED_POINT_H_9A4C27E1
+#define FIXED_POINT_H_9A4C27E1
+
+#include <cstdint>
+#include <cmath>
+#include "vector.h"
+
+/**
+ * Helpers for 16.16 fixed-point numbers, which the PonderingSystem uses when
+ * it is set to fixed-point arithmetic.
+ *
+ * Values are still stored in components as doubles, so that the rest of the
+ * game doesn't need to know about them. Every 16.16 value that a body can
+ * reach is exactly representable as a double, and converting between the two
+ * only involves scaling by a power of two and rounding, so the conversions
+ * give the same results however the game is compiled.
+ */
+using fixed_type = int64_t;
+
+const int FIXED_FRACTION_BITS = 16;
+const fixed_type FIXED_ONE = fixed_type(1) << FIXED_FRACTION_BITS;
+
+/**
+ * Timesteps have more fractional bits than other values, because they are
+ * short enough that 16 bits would noticeably change how fast the game runs.
+ */
+const int FIXED_TIME_FRACTION_BITS = 32;
+
+inline fixed_type toFixed(double value)
+{
+  return static_cast<fixed_type>(std::llround(value * FIXED_ONE));
+}
+
+inline double fromFixed(fixed_type value)
+{
+  return static_cast<double>(value) / FIXED_ONE;
+}
+
+/**
+ * Rounds a value to the nearest 16.16 value.
+ */
+inline double quantize(double value)
+{
+  return fromFixed(toFixed(value));
+}
+
+inline vec2d quantize(const vec2d& value)
+{
+  return { quantize(value.x()), quantize(value.y()) };
+}
+
+inline fixed_type toFixedTime(double dt)
+{
+  return static_cast<fixed_type>(
+    std::llround(std::ldexp(dt, FIXED_TIME_FRACTION_BITS)));
+}
+
+/**
+ * Shifts a value right, rounding halves up.
+ */
+inline fixed_type roundShift(fixed_type value, int bits)
+{
+  return (value + (fixed_type(1) << (bits - 1))) >> bits;
+}
+
+/**
+ * Multiplies a rate, such as a velocity, by a timestep from toFixedTime. The
+ * product has to fit in 64 bits, which holds for rates below 2^15 per second
+ * and timesteps below a second.
+ */
+inline fixed_type scaleByTime(fixed_type rate, fixed_type dt)
+{
+  return roundShift(rate * dt, FIXED_TIME_FRACTION_BITS);
+}
+
+/**
+ * Divides two integers, rounding to the nearest integer and halves away from
+ * zero.
+ */
+inline fixed_type divideRounded(fixed_type num, fixed_type den)
+{
+  if (den < 0)
+  {
+    num = -num;
+    den = -den;
+  }
+
+  if (num < 0)
+  {
+    return -((-num + den / 2) / den);
+  }
+
+  return (num + den / 2) / den;
+}
+
+#endif /* end of include guard: FIXED_POINT_H_9A4C27E1 */
@@ -9,7 +9,14 @@
 #include "systems/realizing.h"
 #include "systems/scripting.h"
 #include "consts.h"
+#include "world_hash.h"
+#include <iostream>
+#include <chrono>
+#include <iomanip>
+#include <stdexcept>
+#include <cmath>
 
+#ifndef HEADLESS
 void key_callback(GLFWwindow* window, int key, int, int action, int)
 {
   Game& game = *static_cast<Game*>(glfwGetWindowUserPointer(window));
@@ -21,10 +28,29 @@ void key_callback(GLFWwindow* window, int key, int, int action, int)
     return;
   }
 
-  game.systemManager_.input(key, action);
+  if ((action == GLFW_PRESS) && (key == GLFW_KEY_F9))
+  {
+    // Exceptions must not unwind through GLFW, so a profile that can't be
+    // written is only reported.
+    try
+    {
+      game.dumpProfile();
+    } catch (const std::exception& ex)
+    {
+      std::cerr << ex.what() << std::endl;
+    }
+
+    return;
+  }
+
+  game.input(key, action);
 }
+#endif
 
-Game::Game(std::mt19937& rng) : rng_(rng)
+Game::Game(
+  std::mt19937& rng) :
+    rng_(rng),
+    systemManager_(&entityManager_)
 {
   systemManager_.emplaceSystem<PlayingSystem>(*this);
   systemManager_.emplaceSystem<SchedulingSystem>(*this);
@@ -41,19 +67,181 @@ Game::Game(std::mt19937& rng) : rng_(rng)
 
   systemManager_.getSystem<PlayingSystem>().initPlayer();
 
+#ifndef HEADLESS
   glfwSwapInterval(1);
   glfwSetWindowUserPointer(renderer_.getWindow().getHandle(), this);
   glfwSetKeyCallback(renderer_.getWindow().getHandle(), key_callback);
+#endif
+}
+
+void Game::setTimestep(double dt)
+{
+  if (!(dt > 0.0) || !std::isfinite(dt))
+  {
+    throw std::invalid_argument("Timestep must be positive and finite");
+  }
+
+  timestep_ = dt;
+}
+
+void Game::recordInput(std::string filename, unsigned int seed)
+{
+  recording_.reset(new InputLog(seed));
+  recordingFile_ = std::move(filename);
+
+  // Deferred commands from concurrently ticking systems are flushed in
+  // whatever order they were recorded, which would make the run irreproducible.
+  systemManager_.setParallel(0);
+}
+
+void Game::replayInput(InputLog log)
+{
+  if (tickLimit_ == 0)
+  {
+    tickLimit_ = log.getLength();
+  }
+
+  timestep_ = log.getTimestep();
+
+  PonderingSystem& pondering = systemManager_.getSystem<PonderingSystem>();
+
+  pondering.setEnvironmentBackend(
+    PonderingSystem::parseEnvironmentBackend(log.getCollisionBackend()));
+
+  pondering.setArithmetic(
+    PonderingSystem::parseArithmetic(log.getArithmetic()));
+
+  replay_.reset(new InputLog(std::move(log)));
+  replayPos_ = 0;
+
+  systemManager_.setParallel(0);
 }
 
+void Game::setHashLog(const std::string& filename)
+{
+  hashLog_.open(filename);
+
+  if (!hashLog_)
+  {
+    throw std::runtime_error("Could not write hash log: " + filename);
+  }
+
+  hashLog_ << std::hex << std::setfill('0');
+
+  // Two runs can only be compared if each of them is reproducible.
+  systemManager_.setParallel(0);
+}
+
+void Game::input(int key, int action)
+{
+  // Live input is ignored while replaying, so that it can't desynchronize the
+  // replay.
+  if (replay_)
+  {
+    return;
+  }
+
+  if (recording_)
+  {
+    recording_->record(ticks_, key, action);
+  }
+
+  systemManager_.input(key, action);
+}
+
+void Game::tick(double dt)
+{
+  if (replay_)
+  {
+    const std::vector<InputLog::Event>& events = replay_->getEvents();
+
+    while ((replayPos_ < events.size()) &&
+      (events[replayPos_].tick <= ticks_))
+    {
+      const InputLog::Event& event = events[replayPos_];
+      systemManager_.input(event.key, event.action);
+
+      replayPos_++;
+    }
+  }
+
+  systemManager_.tick(dt);
+
+  if (hashLog_.is_open())
+  {
+    WorldHash hash = hashWorld(entityManager_);
+
+    hashLog_ << std::dec << ticks_ << std::hex
+      << " " << std::setw(16) << hash.combined()
+      << " " << std::setw(16) << hash.transformable
+      << " " << std::setw(16) << hash.ponderable
+      << " " << std::setw(16) << hash.animatable
+      << " " << std::setw(16) << hash.schedulable
+      << "\n";
+  }
+
+  ticks_++;
+}
+
+void Game::finish()
+{
+  if (recording_)
+  {
+    recording_->setLength(ticks_);
+    recording_->setTimestep(timestep_);
+
+    PonderingSystem& pondering = systemManager_.getSystem<PonderingSystem>();
+
+    recording_->setCollisionBackend(
+      PonderingSystem::getEnvironmentBackendName(
+        pondering.getEnvironmentBackend()));
+
+    recording_->setArithmetic(
+      PonderingSystem::getArithmeticName(pondering.getArithmetic()));
+
+    recording_->save(recordingFile_);
+  }
+
+  if (dumpProfileOnExit_)
+  {
+    dumpProfile();
+  }
+}
+
+#ifdef HEADLESS
+void Game::execute()
+{
+  // Without a display there is nothing to pace the game against, so the
+  // simulation ticks back-to-back with the same fixed timestep.
+  const double dt = timestep_;
+  size_t firstTick = ticks_;
+
+  auto start = std::chrono::steady_clock::now();
+
+  while (!isFinished())
+  {
+    tick(dt);
+  }
+
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+
+  size_t ticks = ticks_ - firstTick;
+
+  std::cout << "Ran " << ticks << " ticks in " << elapsed.count() << "s ("
+    << (ticks / elapsed.count()) << " ticks/s)" << std::endl;
+
+  finish();
+}
+#else
 void Game::execute()
 {
   double lastTime = glfwGetTime();
-  const double dt = 0.01;
+  const double dt = timestep_;
   double accumulator = 0.0;
   Texture texture(GAME_WIDTH, GAME_HEIGHT);
 
-  while (!(shouldQuit_ ||
+  while (!(isFinished() ||
     glfwWindowShouldClose(renderer_.getWindow().getHandle())))
   {
     double currentTime = glfwGetTime();
@@ -63,9 +251,9 @@ void Game::execute()
     glfwPollEvents();
 
     accumulator += frameTime;
-    while (accumulator >= dt)
+    while ((accumulator >= dt) && !isFinished())
     {
-      systemManager_.tick(dt);
+      tick(dt);
 
       accumulator -= dt;
     }
@@ -75,4 +263,18 @@ void Game::execute()
     systemManager_.render(texture);
     renderer_.renderScreen(texture);
   }
+
+  finish();
+}
+#endif
+
+void Game::dumpProfile() const
+{
+  const Profiler& profiler = systemManager_.getProfiler();
+
+  profiler.writeSummary(std::cout);
+  profiler.dump(profileOutput_);
+
+  std::cout << "Wrote profile to " << profileOutput_ << ".csv and "
+    << profileOutput_ << ".json" << std::endl;
 }
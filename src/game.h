@@ -2,8 +2,12 @@
 #define GAME_H_1014DDC9
 
 #include <random>
+#include <string>
+#include <memory>
+#include <fstream>
 #include "entity_manager.h"
 #include "system_manager.h"
+#include "input_log.h"
 #include "renderer/renderer.h"
 
 class Game {
@@ -13,6 +17,76 @@ public:
 
   void execute();
 
+  /**
+   * Sets the path prefix that the system profile is written to. The profile
+   * is written as <prefix>.csv and <prefix>.json when the game exits, and
+   * whenever F9 is pressed.
+   */
+  inline void setProfileOutput(std::string prefix)
+  {
+    profileOutput_ = std::move(prefix);
+    dumpProfileOnExit_ = true;
+  }
+
+  /**
+   * @throws std::runtime_error if the profile cannot be written
+   */
+  void dumpProfile() const;
+
+  /**
+   * Makes execute return after the given number of ticks. Zero means that the
+   * game runs until it is quit.
+   */
+  inline void setTickLimit(size_t ticks)
+  {
+    tickLimit_ = ticks;
+  }
+
+  /**
+   * Sets the length of a tick, in seconds. Bodies are swept along their path
+   * within a tick, so slower machines can run fewer, longer ticks. The
+   * timestep is saved in recordings, and replaying one restores it.
+   *
+   * @throws std::invalid_argument if dt is not a positive, finite number
+   */
+  void setTimestep(double dt);
+
+  /**
+   * Records every input event, which is written to the given file when the
+   * game exits. The seed should be the one that the game's rng was seeded
+   * with. Systems tick serially while recording so that the run can be
+   * reproduced exactly.
+   */
+  void recordInput(std::string filename, unsigned int seed);
+
+  /**
+   * Feeds the game the input from a recording instead of from the keyboard.
+   * The game should have been constructed with an rng seeded with the log's
+   * seed. Unless a tick limit has already been set, the game stops after as
+   * many ticks as the recording ran for. The game switches to the timestep,
+   * collision backend and arithmetic mode that the recording was made with.
+   *
+   * @throws std::invalid_argument if the log names an unknown backend or mode
+   */
+  void replayInput(InputLog log);
+
+  /**
+   * Writes a checksum of the world state to the given file after every tick,
+   * so that the logs of two runs can be diffed to find where they diverge.
+   * Systems tick serially while the log is being written.
+   *
+   * @throws std::runtime_error if the file cannot be opened
+   */
+  void setHashLog(const std::string& filename);
+
+  /**
+   * The number of fixed-step ticks that have been run.
+   */
+  inline size_t getTicks() const
+  {
+    return ticks_;
+  }
+
   inline std::mt19937& getRng()
   {
     return rng_;
@@ -33,20 +107,43 @@ public:
     return systemManager_;
   }
 
+#ifndef HEADLESS
   friend void key_callback(
     GLFWwindow* window,
     int key,
     int scancode,
     int action,
     int mods);
+#endif
 
 private:
 
+  void input(int key, int action);
+
+  void tick(double dt);
+
+  inline bool isFinished() const
+  {
+    return shouldQuit_ || ((tickLimit_ > 0) && (ticks_ >= tickLimit_));
+  }
+
+  void finish();
+
   std::mt19937 rng_;
   Renderer renderer_;
   SystemManager systemManager_;
   EntityManager entityManager_;
   bool shouldQuit_ = false;
+  size_t ticks_ = 0;
+  size_t tickLimit_ = 0;
+  double timestep_ = 0.01;
+  std::unique_ptr<InputLog> recording_;
+  std::string recordingFile_;
+  std::unique_ptr<InputLog> replay_;
+  size_t replayPos_ = 0;
+  std::ofstream hashLog_;
+  bool dumpProfileOnExit_ = false;
+  std::string profileOutput_ = "profile";
 };
 
 #endif /* end of include guard: GAME_H_1014DDC9 */
@@ -0,0 +1,133 @@
+#include "input_log.h"
+#include <cctype>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+
+// The log is plain text so that it can be inspected and edited by hand:
+//
+//   seed <seed>
+//   length <ticks>
+//   timestep <seconds>
+//   collision <backend>
+//   arithmetic <mode>
+//   <tick> <key> <action>
+//   ...
+
+InputLog InputLog::load(const std::string& filename)
+{
+  std::ifstream file(filename);
+  if (!file)
+  {
+    throw std::invalid_argument("Could not open input log: " + filename);
+  }
+
+  std::string field;
+  unsigned int seed;
+  size_t length;
+
+  if (!(file >> field) || (field != "seed") || !(file >> seed) ||
+    !(file >> field) || (field != "length") || !(file >> length))
+  {
+    throw std::invalid_argument("Malformed input log header: " + filename);
+  }
+
+  InputLog log(seed);
+  log.setLength(length);
+
+  // The settings are optional, since older logs don't have them. They are
+  // the only header lines that start with a letter after the length.
+  while (std::isalpha((file >> std::ws).peek()))
+  {
+    if (!(file >> field))
+    {
+      throw std::invalid_argument("Malformed input log header: " + filename);
+    }
+
+    if (field == "timestep")
+    {
+      double timestep;
+
+      if (!(file >> timestep) || !(timestep > 0.0))
+      {
+        throw std::invalid_argument(
+          "Malformed input log header: " + filename);
+      }
+
+      log.setTimestep(timestep);
+    } else if (field == "collision")
+    {
+      std::string backend;
+
+      if (!(file >> backend))
+      {
+        throw std::invalid_argument(
+          "Malformed input log header: " + filename);
+      }
+
+      log.setCollisionBackend(std::move(backend));
+    } else if (field == "arithmetic")
+    {
+      std::string arithmetic;
+
+      if (!(file >> arithmetic))
+      {
+        throw std::invalid_argument(
+          "Malformed input log header: " + filename);
+      }
+
+      log.setArithmetic(std::move(arithmetic));
+    } else {
+      throw std::invalid_argument("Malformed input log header: " + filename);
+    }
+  }
+
+  Event event;
+  while (file >> event.tick >> event.key >> event.action)
+  {
+    log.record(event.tick, event.key, event.action);
+  }
+
+  if (!file.eof())
+  {
+    throw std::invalid_argument("Malformed input log event: " + filename);
+  }
+
+  return log;
+}
+
+void InputLog::save(const std::string& filename) const
+{
+  std::ofstream file(filename);
+  if (!file)
+  {
+    throw std::runtime_error("Could not write input log: " + filename);
+  }
+
+  file << "seed " << seed_ << std::endl;
+  file << "length " << length_ << std::endl;
+
+  // Enough digits that the timestep reads back exactly.
+  file << "timestep "
+    << std::setprecision(std::numeric_limits<double>::max_digits10)
+    << timestep_ << std::endl;
+
+  file << "collision " << collisionBackend_ << std::endl;
+  file << "arithmetic " << arithmetic_ << std::endl;
+
+  for (const Event& event : events_)
+  {
+    file << event.tick << " " << event.key << " " << event.action << std::endl;
+  }
+}
+
+void InputLog::record(size_t tick, int key, int action)
+{
+  if (!events_.empty() && (tick < events_.back().tick))
+  {
+    throw std::invalid_argument("Input events must be recorded in order");
+  }
+
+  events_.push_back({tick, key, action});
+}
@@ -0,0 +1,115 @@
+#ifndef INPUT_LOG_H_93D0A6E1
+#define INPUT_LOG_H_93D0A6E1
+
+#include <string>
+#include <vector>
+
+/**
+ * A recording of the input a game received, along with everything else needed
+ * to reproduce the run: the random seed, the length of a tick, the physics
+ * settings, and the number of ticks that the game ran for. Each event is
+ * stamped with the index of the fixed-step tick that it was delivered before,
+ * so replaying a log feeds the systems exactly the same input at exactly the
+ * same points in the simulation, regardless of frame rate or whether there is
+ * a window at all.
+ */
+class InputLog {
+public:
+
+  struct Event {
+    size_t tick;
+    int key;
+    int action;
+  };
+
+  explicit InputLog(unsigned int seed = 0) : seed_(seed)
+  {
+  }
+
+  /**
+   * Reads a log from a file written by save.
+   *
+   * @throws std::invalid_argument if the file cannot be read or is malformed
+   */
+  static InputLog load(const std::string& filename);
+
+  void save(const std::string& filename) const;
+
+  /**
+   * Events must be recorded in non-decreasing tick order.
+   */
+  void record(size_t tick, int key, int action);
+
+  inline unsigned int getSeed() const
+  {
+    return seed_;
+  }
+
+  /**
+   * The length of a tick in the recorded game, in seconds. Logs from before
+   * this was recorded ran at the default of 0.01.
+   */
+  inline double getTimestep() const
+  {
+    return timestep_;
+  }
+
+  inline void setTimestep(double timestep)
+  {
+    timestep_ = timestep;
+  }
+
+  /**
+   * The names of the collision backend and the arithmetic mode that the
+   * recorded game's physics used. Logs from before these were recorded used
+   * the defaults, boundaries and floating.
+   */
+  inline const std::string& getCollisionBackend() const
+  {
+    return collisionBackend_;
+  }
+
+  inline void setCollisionBackend(std::string backend)
+  {
+    collisionBackend_ = std::move(backend);
+  }
+
+  inline const std::string& getArithmetic() const
+  {
+    return arithmetic_;
+  }
+
+  inline void setArithmetic(std::string arithmetic)
+  {
+    arithmetic_ = std::move(arithmetic);
+  }
+
+  inline const std::vector<Event>& getEvents() const
+  {
+    return events_;
+  }
+
+  /**
+   * The number of ticks that the recorded game ran for.
+   */
+  inline size_t getLength() const
+  {
+    return length_;
+  }
+
+  inline void setLength(size_t length)
+  {
+    length_ = length;
+  }
+
+private:
+
+  unsigned int seed_;
+  size_t length_ = 0;
+  double timestep_ = 0.01;
+  std::string collisionBackend_ = "boundaries";
+  std::string arithmetic_ = "floating";
+  std::vector<Event> events_;
+};
+
+#endif /* end of include guard: INPUT_LOG_H_93D0A6E1 */
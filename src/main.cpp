@@ -1,15 +1,136 @@
 #include <random>
+#include <string>
+#include <stdexcept>
 #include "muxer.h"
 #include "game.h"
+#include "input_log.h"
+#include "systems/pondering.h"
 
-int main()
+int main(int argc, char** argv)
 {
+  std::string profileOutput;
+  std::string recordFile;
+  std::string replayFile;
+  std::string hashFile;
+  size_t tickLimit = 0;
+  double timestep = 0.01;
+  bool timestepGiven = false;
+  PonderingSystem::EnvironmentBackend collisionBackend =
+    PonderingSystem::EnvironmentBackend::boundaries;
+  bool collisionGiven = false;
+  PonderingSystem::Arithmetic arithmetic =
+    PonderingSystem::Arithmetic::floating;
+  bool arithmeticGiven = false;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+
+    if ((arg == "--profile") && (i + 1 < argc))
+    {
+      profileOutput = argv[++i];
+    } else if ((arg == "--ticks") && (i + 1 < argc))
+    {
+      tickLimit = std::stoul(argv[++i]);
+    } else if ((arg == "--record") && (i + 1 < argc))
+    {
+      recordFile = argv[++i];
+    } else if ((arg == "--replay") && (i + 1 < argc))
+    {
+      replayFile = argv[++i];
+    } else if ((arg == "--hash-log") && (i + 1 < argc))
+    {
+      hashFile = argv[++i];
+    } else if ((arg == "--tick-rate") && (i + 1 < argc))
+    {
+      double tickRate = std::stod(argv[++i]);
+
+      if (!(tickRate > 0.0))
+      {
+        throw std::invalid_argument("Tick rate must be positive");
+      }
+
+      timestep = 1.0 / tickRate;
+      timestepGiven = true;
+    } else if ((arg == "--collision") && (i + 1 < argc))
+    {
+      collisionBackend = PonderingSystem::parseEnvironmentBackend(argv[++i]);
+      collisionGiven = true;
+    } else if ((arg == "--arithmetic") && (i + 1 < argc))
+    {
+      arithmetic = PonderingSystem::parseArithmetic(argv[++i]);
+      arithmeticGiven = true;
+    }
+  }
+
+  // A replay has to start from the same seed as the recording.
   std::random_device randomDevice;
-  std::mt19937 rng(randomDevice());
+  unsigned int seed = randomDevice();
+  InputLog replay;
+
+  if (!replayFile.empty())
+  {
+    replay = InputLog::load(replayFile);
+    seed = replay.getSeed();
+
+    // A replay runs at the rate and with the physics it was recorded with, so
+    // asking for anything different can only be a mistake.
+    if (timestepGiven && (timestep != replay.getTimestep()))
+    {
+      throw std::invalid_argument(
+        "Tick rate does not match the recording: " + replayFile);
+    }
+
+    if (collisionGiven && (collisionBackend !=
+      PonderingSystem::parseEnvironmentBackend(replay.getCollisionBackend())))
+    {
+      throw std::invalid_argument(
+        "Collision backend does not match the recording: " + replayFile);
+    }
+
+    if (arithmeticGiven && (arithmetic !=
+      PonderingSystem::parseArithmetic(replay.getArithmetic())))
+    {
+      throw std::invalid_argument(
+        "Arithmetic does not match the recording: " + replayFile);
+    }
+  }
+
+  std::mt19937 rng(seed);
 
   initMuxer();
 
   Game game(rng);
+
+  if (!profileOutput.empty())
+  {
+    game.setProfileOutput(profileOutput);
+  }
+
+  game.setTickLimit(tickLimit);
+  game.setTimestep(timestep);
+
+  game.getSystemManager().getSystem<PonderingSystem>().
+    setEnvironmentBackend(collisionBackend);
+
+  game.getSystemManager().getSystem<PonderingSystem>().
+    setArithmetic(arithmetic);
+
+  if (!replayFile.empty())
+  {
+    game.replayInput(std::move(replay));
+  }
+
+  if (!recordFile.empty())
+  {
+    game.recordInput(recordFile, seed);
+  }
+
+  if (!hashFile.empty())
+  {
+    game.setHashLog(hashFile);
+  }
+
   game.execute();
 
   destroyMuxer();
@@ -0,0 +1,15 @@
+#include "muxer.h"
+
+// Headless builds have no audio device, so sounds are silently dropped.
+
+void initMuxer()
+{
+}
+
+void destroyMuxer()
+{
+}
+
+void playSound(const char*, float)
+{
+}
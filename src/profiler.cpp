@@ -0,0 +1,184 @@
+#include "profiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+
+Profiler::Profiler() : epoch_(clock_type::now())
+{
+}
+
+Profiler::section_id Profiler::addSection(std::string name)
+{
+  Section section;
+  section.name = std::move(name);
+  section.samples.resize(CAPACITY);
+
+  sections_.push_back(std::move(section));
+
+  return sections_.size() - 1;
+}
+
+void Profiler::record(
+  section_id section,
+  clock_type::time_point start,
+  clock_type::time_point end)
+{
+  using micros = std::chrono::duration<double, std::micro>;
+
+  Section& data = sections_[section];
+  Sample& sample = data.samples[data.next];
+
+  sample.start = micros(start - epoch_).count();
+  sample.duration = micros(end - start).count();
+  sample.thread = std::this_thread::get_id();
+
+  data.next = (data.next + 1) % CAPACITY;
+  data.totalCount++;
+  data.totalTime += sample.duration;
+
+  if (data.count < CAPACITY)
+  {
+    data.count++;
+  }
+}
+
+Profiler::Stats Profiler::getStats(section_id section) const
+{
+  const Section& data = sections_[section];
+  Stats stats;
+  stats.totalCount = data.totalCount;
+  stats.totalTime = data.totalTime / 1000.0;
+
+  if (data.count == 0)
+  {
+    return stats;
+  }
+
+  std::vector<double> durations;
+  durations.reserve(data.count);
+
+  forEachSample(data, [&] (const Sample& sample) {
+    durations.push_back(sample.duration / 1000.0);
+  });
+
+  stats.count = durations.size();
+  stats.min = *std::min_element(std::begin(durations), std::end(durations));
+
+  double total = 0.0;
+  for (double duration : durations)
+  {
+    total += duration;
+  }
+
+  stats.avg = total / durations.size();
+
+  size_t p99Index = (durations.size() * 99) / 100;
+  if (p99Index >= durations.size())
+  {
+    p99Index = durations.size() - 1;
+  }
+
+  std::nth_element(
+    std::begin(durations),
+    std::begin(durations) + p99Index,
+    std::end(durations));
+
+  stats.p99 = durations[p99Index];
+
+  return stats;
+}
+
+void Profiler::writeCsv(std::ostream& out) const
+{
+  out << "section,start_us,duration_us" << std::endl;
+  out << std::fixed << std::setprecision(3);
+
+  for (const Section& section : sections_)
+  {
+    forEachSample(section, [&] (const Sample& sample) {
+      out << "\"" << section.name << "\","
+        << sample.start << ","
+        << sample.duration << std::endl;
+    });
+  }
+}
+
+void Profiler::writeChromeTrace(std::ostream& out) const
+{
+  // Chrome wants small integer thread IDs.
+  std::map<std::thread::id, size_t> threadIds;
+
+  out << "{\"traceEvents\":[";
+  out << std::fixed << std::setprecision(3);
+
+  bool first = true;
+
+  for (const Section& section : sections_)
+  {
+    forEachSample(section, [&] (const Sample& sample) {
+      if (!threadIds.count(sample.thread))
+      {
+        size_t tid = threadIds.size();
+        threadIds[sample.thread] = tid;
+      }
+
+      if (!first)
+      {
+        out << ",";
+      }
+
+      first = false;
+
+      out << std::endl << "{\"name\":\"" << section.name << "\""
+        << ",\"ph\":\"X\",\"pid\":0"
+        << ",\"tid\":" << threadIds[sample.thread]
+        << ",\"ts\":" << sample.start
+        << ",\"dur\":" << sample.duration << "}";
+    });
+  }
+
+  out << std::endl << "]}" << std::endl;
+}
+
+void Profiler::writeSummary(std::ostream& out) const
+{
+  out << std::left << std::setw(32) << "section"
+    << std::right << std::setw(8) << "count"
+    << std::setw(12) << "min ms"
+    << std::setw(12) << "avg ms"
+    << std::setw(12) << "p99 ms" << std::endl;
+
+  out << std::fixed << std::setprecision(4);
+
+  for (section_id section = 0; section < sections_.size(); section++)
+  {
+    Stats stats = getStats(section);
+
+    out << std::left << std::setw(32) << sections_[section].name
+      << std::right << std::setw(8) << stats.count
+      << std::setw(12) << stats.min
+      << std::setw(12) << stats.avg
+      << std::setw(12) << stats.p99 << std::endl;
+  }
+}
+
+void Profiler::dump(const std::string& prefix) const
+{
+  std::ofstream csv(prefix + ".csv");
+  if (!csv)
+  {
+    throw std::runtime_error("Cannot write profile to " + prefix + ".csv");
+  }
+
+  writeCsv(csv);
+
+  std::ofstream trace(prefix + ".json");
+  if (!trace)
+  {
+    throw std::runtime_error("Cannot write profile to " + prefix + ".json");
+  }
+
+  writeChromeTrace(trace);
+}
@@ -0,0 +1,153 @@
+#ifndef PROFILER_H_4C8E1F05
+#define PROFILER_H_4C8E1F05
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <ostream>
+
+/**
+ * Collects wall clock timings for named sections of code. Each section keeps
+ * its most recent samples in a fixed-size ring buffer, so profiling can stay
+ * enabled indefinitely without growing.
+ *
+ * Different sections may be recorded from different threads at the same time,
+ * but a single section must only be recorded from one thread at a time.
+ */
+class Profiler {
+public:
+
+  using clock_type = std::chrono::steady_clock;
+  using section_id = size_t;
+
+  static const size_t CAPACITY = 1024;
+
+  struct Stats {
+    size_t count = 0;
+    double min = 0.0;
+    double avg = 0.0;
+    double p99 = 0.0;
+
+    /**
+     * The number and total duration of every sample ever recorded, including
+     * those that have since been dropped from the ring buffer.
+     */
+    size_t totalCount = 0;
+    double totalTime = 0.0;
+  };
+
+  Profiler();
+
+  /**
+   * Creates a new section and returns its ID.
+   */
+  section_id addSection(std::string name);
+
+  inline const std::string& getSectionName(section_id section) const
+  {
+    return sections_[section].name;
+  }
+
+  inline size_t getNumSections() const
+  {
+    return sections_.size();
+  }
+
+  void record(
+    section_id section,
+    clock_type::time_point start,
+    clock_type::time_point end);
+
+  /**
+   * Computes statistics, in milliseconds, over the samples currently in a
+   * section's ring buffer.
+   */
+  Stats getStats(section_id section) const;
+
+  /**
+   * Writes every buffered sample as a row of comma-separated values.
+   */
+  void writeCsv(std::ostream& out) const;
+
+  /**
+   * Writes every buffered sample in the Chrome trace event format, which can
+   * be loaded into chrome://tracing or Perfetto.
+   */
+  void writeChromeTrace(std::ostream& out) const;
+
+  /**
+   * Writes a table of per-section statistics.
+   */
+  void writeSummary(std::ostream& out) const;
+
+  /**
+   * Writes <prefix>.csv and <prefix>.json.
+   *
+   * @throws std::runtime_error if either file cannot be opened
+   */
+  void dump(const std::string& prefix) const;
+
+private:
+
+  struct Sample {
+    double start;
+    double duration;
+    std::thread::id thread;
+  };
+
+  struct Section {
+    std::string name;
+    std::vector<Sample> samples;
+    size_t next = 0;
+    size_t count = 0;
+    size_t totalCount = 0;
+    double totalTime = 0.0;
+  };
+
+  /**
+   * Calls a function on each buffered sample of a section, oldest first.
+   */
+  template <typename F>
+  void forEachSample(const Section& section, F&& fn) const
+  {
+    size_t first = (section.count < CAPACITY) ? 0 : section.next;
+
+    for (size_t i = 0; i < section.count; i++)
+    {
+      fn(section.samples[(first + i) % CAPACITY]);
+    }
+  }
+
+  clock_type::time_point epoch_;
+  std::vector<Section> sections_;
+};
+
+/**
+ * Records the lifetime of the object as a sample of a section.
+ */
+class ProfileScope {
+public:
+
+  ProfileScope(
+    Profiler& profiler,
+    Profiler::section_id section) :
+      profiler_(profiler),
+      section_(section),
+      start_(Profiler::clock_type::now())
+  {
+  }
+
+  ~ProfileScope()
+  {
+    profiler_.record(section_, start_, Profiler::clock_type::now());
+  }
+
+private:
+
+  Profiler& profiler_;
+  Profiler::section_id section_;
+  Profiler::clock_type::time_point start_;
+};
+
+#endif /* end of include guard: PROFILER_H_4C8E1F05 */
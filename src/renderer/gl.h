@@ -1,7 +1,14 @@
 #ifndef GL_H_3EE4A268
 #define GL_H_3EE4A268
 
+#ifdef HEADLESS
+// Headless builds only use GLFW's key and action constants, so neither an
+// OpenGL header nor the GLFW library itself is needed.
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#else
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#endif
 
 #endif /* end of include guard: GL_H_3EE4A268 */
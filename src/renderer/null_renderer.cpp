@@ -0,0 +1,68 @@
+#include "renderer.h"
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <stb_image.h>
+#include "texture.h"
+
+void Renderer::fill(Texture&, Rectangle, int, int, int)
+{
+}
+
+void Renderer::blit(const Texture&, Texture&, Rectangle, Rectangle, double)
+{
+}
+
+void Renderer::renderScreen(const Texture&)
+{
+}
+
+// Headless textures have dimensions but no pixel data.
+
+Texture::Texture(
+  int width,
+  int height) :
+    width_(width),
+    height_(height)
+{
+}
+
+Texture::Texture(const char* filename)
+{
+  // Only the image header is read, so that frame rects can still be computed.
+  if (!stbi_info(filename, &width_, &height_, nullptr))
+  {
+    throw std::invalid_argument(
+      std::string("Could not read image: ") + filename);
+  }
+}
+
+Texture::Texture(
+  const Texture& tex) :
+    width_(tex.width_),
+    height_(tex.height_)
+{
+}
+
+Texture::Texture(Texture&& tex) : Texture(0, 0)
+{
+  swap(*this, tex);
+}
+
+Texture& Texture::operator= (Texture tex)
+{
+  swap(*this, tex);
+
+  return *this;
+}
+
+void swap(Texture& tex1, Texture& tex2)
+{
+  std::swap(tex1.width_, tex2.width_);
+  std::swap(tex1.height_, tex2.height_);
+}
+
+Rectangle Texture::entirety() const
+{
+  return {0, 0, width_, height_};
+}
@@ -0,0 +1,41 @@
+#ifndef NULL_RENDERER_H_6F2B07D9
+#define NULL_RENDERER_H_6F2B07D9
+
+class Texture;
+struct Rectangle;
+
+/**
+ * Stands in for the renderer in headless builds. There is no window or GL
+ * context, and all drawing operations do nothing.
+ */
+class Renderer {
+public:
+
+  static inline bool isSingletonInitialized()
+  {
+    return true;
+  }
+
+  Renderer() = default;
+
+  Renderer(const Renderer& other) = delete;
+  Renderer& operator=(const Renderer& other) = delete;
+
+  void fill(
+    Texture& tex,
+    Rectangle loc,
+    int r,
+    int g,
+    int b);
+
+  void blit(
+    const Texture& src,
+    Texture& dst,
+    Rectangle srcrect,
+    Rectangle dstrect,
+    double alpha = 1.0);
+
+  void renderScreen(const Texture& tex);
+};
+
+#endif /* end of include guard: NULL_RENDERER_H_6F2B07D9 */
@@ -1,6 +1,10 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#ifdef HEADLESS
+#include "null_renderer.h"
+#else
+
 #include "gl.h"
 #include "wrappers.h"
 #include "mesh.h"
@@ -111,4 +115,6 @@ private:
   int height_;
 };
 
+#endif /* HEADLESS */
+
 #endif
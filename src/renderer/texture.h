@@ -1,7 +1,9 @@
 #ifndef TEXTURE_H_84EC6DF6
 #define TEXTURE_H_84EC6DF6
 
+#ifndef HEADLESS
 #include "wrappers.h"
+#endif
 
 struct Rectangle {
   int x;
@@ -27,10 +29,12 @@ public:
 
   Rectangle entirety() const;
 
+#ifndef HEADLESS
   inline GLuint getId() const
   {
     return texture_.getId();
   }
+#endif
 
   inline int getWidth() const
   {
@@ -44,7 +48,9 @@ public:
 
 private:
 
+#ifndef HEADLESS
   GLTexture texture_;
+#endif
   int width_;
   int height_;
 };
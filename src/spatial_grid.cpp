@@ -0,0 +1,131 @@
+#include "spatial_grid.h"
+#include <algorithm>
+#include <cmath>
+
+inline int clampCell(double coord, int cellSize, int numCells)
+{
+  int cell = static_cast<int>(std::floor(coord / cellSize));
+
+  return std::max(0, std::min(cell, numCells - 1));
+}
+
+SpatialGrid::CellRange SpatialGrid::getCellRange(
+  const vec2d& lower,
+  const vec2d& upper)
+{
+  return {
+    clampCell(lower.x(), CELL_WIDTH, COLUMNS),
+    clampCell(lower.y(), CELL_HEIGHT, ROWS),
+    clampCell(upper.x(), CELL_WIDTH, COLUMNS),
+    clampCell(upper.y(), CELL_HEIGHT, ROWS)
+  };
+}
+
+void SpatialGrid::clear()
+{
+  for (std::vector<id_type>& cell : cells_)
+  {
+    cell.clear();
+  }
+
+  for (Record& record : records_)
+  {
+    record.present = false;
+  }
+}
+
+void SpatialGrid::update(id_type entity, const vec2d& pos, const vec2i& size)
+{
+  EntityHandle::index_type slot = EntityHandle::getIndex(entity);
+
+  if (slot >= records_.size())
+  {
+    records_.resize(slot + 1);
+  }
+
+  Record& record = records_[slot];
+  CellRange range = getCellRange(pos, pos + vec2d(size));
+
+  if (record.present)
+  {
+    // Most moves stay within the same cells.
+    if ((record.entity == entity) &&
+      (record.range.left == range.left) &&
+      (record.range.top == range.top) &&
+      (record.range.right == range.right) &&
+      (record.range.bottom == range.bottom))
+    {
+      return;
+    }
+
+    removeFromCells(record.entity, record.range);
+  }
+
+  insertIntoCells(entity, range);
+
+  record.entity = entity;
+  record.present = true;
+  record.range = range;
+}
+
+void SpatialGrid::remove(id_type entity)
+{
+  EntityHandle::index_type slot = EntityHandle::getIndex(entity);
+
+  if ((slot < records_.size()) &&
+    records_[slot].present &&
+    (records_[slot].entity == entity))
+  {
+    removeFromCells(entity, records_[slot].range);
+
+    records_[slot].present = false;
+  }
+}
+
+void SpatialGrid::query(
+  const vec2d& lower,
+  const vec2d& upper,
+  std::vector<id_type>& out) const
+{
+  CellRange range = getCellRange(lower, upper);
+
+  for (int y = range.top; y <= range.bottom; y++)
+  {
+    for (int x = range.left; x <= range.right; x++)
+    {
+      const std::vector<id_type>& cell = cells_[y * COLUMNS + x];
+
+      out.insert(std::end(out), std::begin(cell), std::end(cell));
+    }
+  }
+}
+
+void SpatialGrid::insertIntoCells(id_type entity, const CellRange& range)
+{
+  for (int y = range.top; y <= range.bottom; y++)
+  {
+    for (int x = range.left; x <= range.right; x++)
+    {
+      cells_[y * COLUMNS + x].push_back(entity);
+    }
+  }
+}
+
+void SpatialGrid::removeFromCells(id_type entity, const CellRange& range)
+{
+  for (int y = range.top; y <= range.bottom; y++)
+  {
+    for (int x = range.left; x <= range.right; x++)
+    {
+      std::vector<id_type>& cell = cells_[y * COLUMNS + x];
+
+      auto it = std::find(std::begin(cell), std::end(cell), entity);
+
+      if (it != std::end(cell))
+      {
+        *it = cell.back();
+        cell.pop_back();
+      }
+    }
+  }
+}
@@ -0,0 +1,87 @@
+#ifndef SPATIAL_GRID_H_5B19E3A7
+#define SPATIAL_GRID_H_5B19E3A7
+
+#include <vector>
+#include "entity_handle.h"
+#include "vector.h"
+#include "consts.h"
+
+/**
+ * A uniform grid over the map, used as a broadphase so that a moving body only
+ * has to be tested against bodies near its path instead of against every body.
+ *
+ * Each body is stored in every cell that its bounding box touches. Bounds are
+ * inclusive on both ends, so bodies that are merely touching still share a
+ * cell. Anything outside of the map is stored in the nearest border cell.
+ */
+class SpatialGrid {
+public:
+
+  using id_type = EntityHandle::id_type;
+
+  static const int CELL_WIDTH = TILE_WIDTH * 4;
+  static const int CELL_HEIGHT = TILE_HEIGHT * 4;
+
+  static const int COLUMNS = (GAME_WIDTH + CELL_WIDTH - 1) / CELL_WIDTH;
+  static const int ROWS =
+    (MAP_HEIGHT * TILE_HEIGHT + CELL_HEIGHT - 1) / CELL_HEIGHT;
+
+  SpatialGrid() : cells_(COLUMNS * ROWS)
+  {
+  }
+
+  /**
+   * Removes every body from the grid.
+   */
+  void clear();
+
+  /**
+   * Inserts a body into the grid, or moves it if it is already there.
+   */
+  void update(id_type entity, const vec2d& pos, const vec2i& size);
+
+  void remove(id_type entity);
+
+  /**
+   * Appends every body whose cells overlap the given box to the output. A body
+   * that spans several cells may be appended more than once, and bodies are
+   * not appended in any particular order.
+   */
+  void query(
+    const vec2d& lower,
+    const vec2d& upper,
+    std::vector<id_type>& out) const;
+
+private:
+
+  struct CellRange {
+    int left;
+    int top;
+    int right;
+    int bottom;
+  };
+
+  struct Record {
+    id_type entity;
+    bool present = false;
+    CellRange range;
+  };
+
+  static CellRange getCellRange(const vec2d& lower, const vec2d& upper);
+
+  void insertIntoCells(id_type entity, const CellRange& range);
+
+  void removeFromCells(id_type entity, const CellRange& range);
+
+  /**
+   * The bodies in each cell, in row-major order.
+   */
+  std::vector<std::vector<id_type>> cells_;
+
+  /**
+   * The cells that each body is stored in, indexed by the body's slot.
+   */
+  std::vector<Record> records_;
+};
+
+#endif /* end of include guard: SPATIAL_GRID_H_5B19E3A7 */
@@ -10,6 +10,29 @@ class System {
 public:
 
   using id_type = EntityManager::id_type;
+  using signature_type = EntityManager::signature_type;
+
+  /**
+   * Describes what a system's tick touches, so that the SystemManager can
+   * decide which systems are able to tick concurrently.
+   *
+   * reads     - The component types that the tick reads.
+   * writes    - The component types that the tick modifies.
+   * exclusive - If enabled, the tick may touch anything (for instance by
+   *             calling into other systems or running scripts), and it will
+   *             never run alongside another system.
+   * ticks     - If disabled, the system doesn't override tick, and it is
+   *             left out of the schedule.
+   *
+   * A system that ticks concurrently with others must not make structural
+   * changes directly; it should use the deferred EntityManager methods.
+   */
+  struct Access {
+    signature_type reads;
+    signature_type writes;
+    bool exclusive = true;
+    bool ticks = true;
+  };
 
   System(Game& game) : game_(game)
   {
@@ -17,6 +40,15 @@ public:
 
   virtual ~System() = default;
 
+  /**
+   * Returns what the system's tick touches. By default, a system is assumed to
+   * be exclusive.
+   */
+  virtual Access getAccess() const
+  {
+    return {};
+  }
+
   /**
    * Updates the state of a system.
    *
@@ -0,0 +1,189 @@
+#include "system_manager.h"
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
+
+inline bool conflicts(const System::Access& left, const System::Access& right)
+{
+  if (left.exclusive || right.exclusive)
+  {
+    return true;
+  }
+
+  return (left.writes & (right.reads | right.writes)).any() ||
+    (right.writes & left.reads).any();
+}
+
+/**
+ * Turns a type into a human-readable name for profiling reports.
+ */
+inline std::string getTypeName(const std::type_info& type)
+{
+#ifdef __GNUG__
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+
+  if (status == 0)
+  {
+    std::string result(demangled);
+    std::free(demangled);
+
+    return result;
+  }
+#endif
+
+  return type.name();
+}
+
+void SystemManager::addSystem(
+  SystemFamily::id_type systemType,
+  std::unique_ptr<System> system,
+  const std::type_info& type)
+{
+  if (systemType >= systems.size())
+  {
+    systems.resize(systemType + 1, nullptr);
+  }
+
+  systems[systemType] = system.get();
+
+  std::string name = getTypeName(type);
+
+  SystemEntry entry;
+  entry.system = std::move(system);
+  entry.tickSection = profiler.addSection(name + "::tick");
+  entry.renderSection = profiler.addSection(name + "::render");
+
+  loop.push_back(std::move(entry));
+
+  scheduleDirty = true;
+}
+
+void SystemManager::setParallel(size_t numWorkers)
+{
+  if (numWorkers == 0)
+  {
+    workers.reset();
+  } else {
+    workers.reset(new WorkerPool(numWorkers));
+  }
+}
+
+void SystemManager::buildSchedule()
+{
+  std::vector<SystemEntry*> ordered;
+  std::vector<System::Access> accesses;
+  std::vector<size_t> stageOf;
+
+  for (SystemEntry& entry : loop)
+  {
+    System::Access access = entry.system->getAccess();
+
+    // Systems that don't tick would only make a stage look parallel.
+    if (!access.ticks)
+    {
+      continue;
+    }
+
+    // A system must tick after every earlier system it conflicts with.
+    size_t stage = 0;
+
+    for (size_t i = 0; i < ordered.size(); i++)
+    {
+      if (conflicts(accesses[i], access) && (stageOf[i] + 1 > stage))
+      {
+        stage = stageOf[i] + 1;
+      }
+    }
+
+    ordered.push_back(&entry);
+    accesses.push_back(access);
+    stageOf.push_back(stage);
+  }
+
+  stages.clear();
+
+  for (size_t i = 0; i < ordered.size(); i++)
+  {
+    if (stageOf[i] >= stages.size())
+    {
+      stages.resize(stageOf[i] + 1);
+    }
+
+    stages[stageOf[i]].push_back(ordered[i]);
+  }
+
+  scheduleDirty = false;
+}
+
+void SystemManager::tickSystem(SystemEntry& entry, double dt)
+{
+  if (profiling)
+  {
+    ProfileScope scope(profiler, entry.tickSection);
+
+    entry.system->tick(dt);
+  } else {
+    entry.system->tick(dt);
+  }
+}
+
+void SystemManager::tick(double dt)
+{
+  if (!workers)
+  {
+    for (SystemEntry& entry : loop)
+    {
+      tickSystem(entry, dt);
+
+      // Apply the structural changes that the system deferred, so that the
+      // next system sees a consistent set of entities.
+      entityManager->flushCommands();
+    }
+
+    return;
+  }
+
+  if (scheduleDirty)
+  {
+    buildSchedule();
+  }
+
+  for (std::vector<SystemEntry*>& stage : stages)
+  {
+    if (stage.size() == 1)
+    {
+      tickSystem(*stage.front(), dt);
+    } else {
+      std::vector<WorkerPool::task_type> tasks;
+
+      for (SystemEntry* entry : stage)
+      {
+        tasks.emplace_back([this, entry, dt] () {
+          tickSystem(*entry, dt);
+        });
+      }
+
+      workers->run(std::move(tasks));
+    }
+
+    entityManager->flushCommands();
+  }
+}
+
+void SystemManager::render(Texture& texture)
+{
+  for (SystemEntry& entry : loop)
+  {
+    if (profiling)
+    {
+      ProfileScope scope(profiler, entry.renderSection);
+
+      entry.system->render(texture);
+    } else {
+      entry.system->render(texture);
+    }
+  }
+}
@@ -3,63 +3,140 @@
 
 #include <list>
 #include <memory>
-#include <map>
-#include <typeindex>
+#include <vector>
 #include <stdexcept>
+#include <string>
+#include <typeinfo>
 #include "system.h"
+#include "profiler.h"
+#include "type_family.h"
+#include "worker_pool.h"
 
 class SystemManager {
 private:
 
-  std::list<std::unique_ptr<System>> loop;
-  std::map<std::type_index, System*> systems;
+  using SystemFamily = TypeFamily<System>;
+
+  /**
+   * The entity manager whose deferred commands are flushed between systems.
+   */
+  EntityManager* entityManager;
+
+  struct SystemEntry {
+    std::unique_ptr<System> system;
+    Profiler::section_id tickSection;
+    Profiler::section_id renderSection;
+  };
+
+  std::list<SystemEntry> loop;
+
+  /**
+   * Systems indexed by their family ID, for constant time lookup.
+   */
+  std::vector<System*> systems;
+
+  /**
+   * The tick schedule. Each stage is a group of systems whose declared
+   * accesses do not conflict, so they may tick concurrently. Stages run in
+   * order, and a system is always placed in a later stage than any
+   * conflicting system that was emplaced before it. Systems that don't tick
+   * are left out, so that only stages with two or more ticking systems are
+   * handed to the workers.
+   */
+  std::vector<std::vector<SystemEntry*>> stages;
+  bool scheduleDirty = true;
+
+  /**
+   * The workers used to tick systems concurrently. If this is null, systems
+   * tick serially in the order they were emplaced.
+   */
+  std::unique_ptr<WorkerPool> workers;
+
+  /**
+   * Per-system tick and render timings.
+   */
+  Profiler profiler;
+  bool profiling = true;
+
+  void buildSchedule();
+
+  void addSystem(
+    SystemFamily::id_type systemType,
+    std::unique_ptr<System> system,
+    const std::type_info& type);
+
+  void tickSystem(SystemEntry& entry, double dt);
 
 public:
 
+  SystemManager(EntityManager* entityManager) : entityManager(entityManager)
+  {
+  }
+
   template <class T, class... Args>
   void emplaceSystem(Game& game, Args&&... args)
   {
     std::unique_ptr<T> ptr(new T(game, std::forward<Args>(args)...));
-    std::type_index systemType = typeid(T);
 
-    systems[systemType] = ptr.get();
-    loop.push_back(std::move(ptr));
+    addSystem(SystemFamily::getId<T>(), std::move(ptr), typeid(T));
   }
 
-  template <class T>
-  T& getSystem()
+  /**
+   * Enables or disables ticking non-conflicting systems concurrently. When
+   * disabled, systems tick one at a time in the order they were emplaced,
+   * which is fully deterministic.
+   *
+   * @param numWorkers - The number of worker threads to use in addition to
+   *                     the ticking thread. Zero disables parallel ticking.
+   */
+  void setParallel(size_t numWorkers);
+
+  inline bool isParallel() const
   {
-    std::type_index systemType = typeid(T);
+    return static_cast<bool>(workers);
+  }
 
-    if (!systems.count(systemType))
-    {
-      throw std::invalid_argument("Cannot get non-existent system");
-    }
+  /**
+   * Enables or disables timing each system's tick and render. Profiling is
+   * enabled by default.
+   */
+  inline void setProfiling(bool enabled)
+  {
+    profiling = enabled;
+  }
 
-    return *dynamic_cast<T*>(systems[systemType]);
+  inline bool isProfiling() const
+  {
+    return profiling;
   }
 
-  void tick(double dt)
+  inline const Profiler& getProfiler() const
   {
-    for (std::unique_ptr<System>& sys : loop)
-    {
-      sys->tick(dt);
-    }
+    return profiler;
   }
 
-  virtual void render(Texture& texture)
+  template <class T>
+  T& getSystem()
   {
-    for (std::unique_ptr<System>& sys : loop)
+    SystemFamily::id_type systemType = SystemFamily::getId<T>();
+
+    if ((systemType >= systems.size()) || (systems[systemType] == nullptr))
     {
-      sys->render(texture);
+      throw std::invalid_argument("Cannot get non-existent system");
     }
+
+    return *static_cast<T*>(systems[systemType]);
   }
 
+  void tick(double dt);
+
+  virtual void render(Texture& texture);
+
   virtual void input(int key, int action)
   {
-    for (std::unique_ptr<System>& sys : loop)
+    for (SystemEntry& entry : loop)
     {
-      sys->input(key, action);
+      entry.system->input(key, action);
     }
   }
 
@@ -5,79 +5,76 @@
 
 void AnimatingSystem::tick(double)
 {
-  std::set<id_type> spriteEntities =
-    game_.getEntityManager().getEntitiesWithComponents<AnimatableComponent>();
-
-  for (id_type entity : spriteEntities)
-  {
-    auto& sprite = game_.getEntityManager().
-      getComponent<AnimatableComponent>(entity);
-
-    if (sprite.active)
-    {
-      if (!sprite.frozen)
-      {
-        sprite.countdown++;
-      }
-
-      const Animation& anim = sprite.getAnimation();
-      if (sprite.countdown >= anim.getDelay())
+  game_.getEntityManager().each<AnimatableComponent>(
+    [] (id_type, AnimatableComponent& sprite) {
+      if (sprite.active)
       {
-        sprite.frame++;
-        sprite.countdown = 0;
+        if (!sprite.frozen)
+        {
+          sprite.countdown++;
+        }
 
-        if (sprite.frame >= anim.getFirstFrame() + anim.getNumFrames())
+        const Animation& anim = sprite.getAnimation();
+        if (sprite.countdown >= anim.getDelay())
         {
-          sprite.frame = anim.getFirstFrame();
+          sprite.frame++;
+          sprite.countdown = 0;
+
+          if (sprite.frame >= anim.getFirstFrame() + anim.getNumFrames())
+          {
+            sprite.frame = anim.getFirstFrame();
+          }
         }
-      }
 
-      if (sprite.flickering)
-      {
-        sprite.flickerTimer = (sprite.flickerTimer + 1) % 6;
+        if (sprite.flickering)
+        {
+          sprite.flickerTimer = (sprite.flickerTimer + 1) % 6;
+        }
       }
-    }
-  }
+    });
 }
 
-void AnimatingSystem::render(Texture& texture)
+System::Access AnimatingSystem::getAccess() const
 {
-  std::set<id_type> spriteEntities =
-    game_.getEntityManager().getEntitiesWithComponents<
-      AnimatableComponent,
-      TransformableComponent>();
-
-  for (id_type entity : spriteEntities)
-  {
-    auto& sprite = game_.getEntityManager().
-      getComponent<AnimatableComponent>(entity);
-
-    if (sprite.active)
-    {
-      auto& transform = game_.getEntityManager().
-        getComponent<TransformableComponent>(entity);
-
-      double alpha = 1.0;
-      if (sprite.flickering && (sprite.flickerTimer < 3))
-      {
-        alpha = 0.0;
-      }
+  Access access;
+  access.exclusive = false;
+  access.writes = EntityManager::getSignature<AnimatableComponent>();
 
-      Rectangle dstrect {
-        static_cast<int>(transform.pos.x()),
-        static_cast<int>(transform.pos.y()),
-        transform.size.w(),
-        transform.size.h()};
+  return access;
+}
 
-      const AnimationSet& aset = sprite.animationSet;
-      game_.getRenderer().blit(
-        aset.getTexture(),
-        texture,
-        aset.getFrameRect(sprite.frame),
-        dstrect,
-        alpha);
-    }
-  }
+void AnimatingSystem::render(Texture& texture)
+{
+  game_.getEntityManager().each<
+    AnimatableComponent,
+    TransformableComponent>(
+      [&] (
+        id_type,
+        AnimatableComponent& sprite,
+        TransformableComponent& transform) {
+        if (sprite.active)
+        {
+          double alpha = 1.0;
+          if (sprite.flickering && (sprite.flickerTimer < 3))
+          {
+            alpha = 0.0;
+          }
+
+          Rectangle dstrect {
+            static_cast<int>(transform.pos.x()),
+            static_cast<int>(transform.pos.y()),
+            transform.size.w(),
+            transform.size.h()};
+
+          const AnimationSet& aset = sprite.animationSet;
+          game_.getRenderer().blit(
+            aset.getTexture(),
+            texture,
+            aset.getFrameRect(sprite.frame),
+            dstrect,
+            alpha);
+        }
+      });
 }
 
 void AnimatingSystem::initPrototype(id_type entity)
@@ -14,6 +14,8 @@ public:
 
   void tick(double dt);
 
+  Access getAccess() const;
+
   void render(Texture& texture);
 
   void initPrototype(id_type entity);
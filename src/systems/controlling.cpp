@@ -2,105 +2,126 @@
 #include "game.h"
 #include "components/controllable.h"
 #include "components/orientable.h"
+#include "components/ponderable.h"
+#include "components/animatable.h"
 #include "systems/orienting.h"
 
 void ControllingSystem::tick(double)
 {
+  auto& orienting = game_.getSystemManager().getSystem<OrientingSystem>();
+
   while (!actions_.empty())
   {
     int key = actions_.front().first;
     int action = actions_.front().second;
 
-    auto entities = game_.getEntityManager().getEntitiesWithComponents<
+    game_.getEntityManager().each<
       ControllableComponent,
-      OrientableComponent>();
-
-    for (auto entity : entities)
-    {
-      auto& controllable = game_.getEntityManager().
-        getComponent<ControllableComponent>(entity);
-
-      auto& orienting = game_.getSystemManager().getSystem<OrientingSystem>();
-
-      if (action == GLFW_PRESS)
-      {
-        if (key == controllable.getLeftKey())
-        {
-          controllable.setHoldingLeft(true);
-
-          if (!controllable.isFrozen())
+      OrientableComponent>(
+        [&] (
+          id_type entity,
+          ControllableComponent& controllable,
+          OrientableComponent&) {
+          if (action == GLFW_PRESS)
           {
-            orienting.moveLeft(entity);
-          }
-        } else if (key == controllable.getRightKey())
-        {
-          controllable.setHoldingRight(true);
+            if (key == controllable.getLeftKey())
+            {
+              controllable.setHoldingLeft(true);
 
-          if (!controllable.isFrozen())
-          {
-            orienting.moveRight(entity);
-          }
-        } else if (key == controllable.getJumpKey())
-        {
-          if (!controllable.isFrozen())
-          {
-            orienting.jump(entity);
-          }
-        } else if (key == controllable.getDropKey())
-        {
-          if (!controllable.isFrozen())
-          {
-            orienting.drop(entity);
-          }
-        }
-      } else if (action == GLFW_RELEASE)
-      {
-        if (key == controllable.getLeftKey())
-        {
-          controllable.setHoldingLeft(false);
-
-          if (!controllable.isFrozen())
-          {
-            if (controllable.isHoldingRight())
+              if (!controllable.isFrozen())
+              {
+                orienting.moveLeft(entity);
+              }
+            } else if (key == controllable.getRightKey())
             {
-              orienting.moveRight(entity);
-            } else {
-              orienting.stopWalking(entity);
-            }
-          }
-        } else if (key == controllable.getRightKey())
-        {
-          controllable.setHoldingRight(false);
+              controllable.setHoldingRight(true);
 
-          if (!controllable.isFrozen())
-          {
-            if (controllable.isHoldingLeft())
+              if (!controllable.isFrozen())
+              {
+                orienting.moveRight(entity);
+              }
+            } else if (key == controllable.getJumpKey())
             {
-              orienting.moveLeft(entity);
-            } else {
-              orienting.stopWalking(entity);
+              if (!controllable.isFrozen())
+              {
+                orienting.jump(entity);
+              }
+            } else if (key == controllable.getDropKey())
+            {
+              if (!controllable.isFrozen())
+              {
+                orienting.drop(entity);
+              }
             }
-          }
-        } else if (key == controllable.getDropKey())
-        {
-          if (!controllable.isFrozen())
+          } else if (action == GLFW_RELEASE)
           {
-            orienting.stopDropping(entity);
-          }
-        } else if (key == controllable.getJumpKey())
-        {
-          if (!controllable.isFrozen())
-          {
-            orienting.stopJumping(entity);
+            if (key == controllable.getLeftKey())
+            {
+              controllable.setHoldingLeft(false);
+
+              if (!controllable.isFrozen())
+              {
+                if (controllable.isHoldingRight())
+                {
+                  orienting.moveRight(entity);
+                } else {
+                  orienting.stopWalking(entity);
+                }
+              }
+            } else if (key == controllable.getRightKey())
+            {
+              controllable.setHoldingRight(false);
+
+              if (!controllable.isFrozen())
+              {
+                if (controllable.isHoldingLeft())
+                {
+                  orienting.moveLeft(entity);
+                } else {
+                  orienting.stopWalking(entity);
+                }
+              }
+            } else if (key == controllable.getDropKey())
+            {
+              if (!controllable.isFrozen())
+              {
+                orienting.stopDropping(entity);
+              }
+            } else if (key == controllable.getJumpKey())
+            {
+              if (!controllable.isFrozen())
+              {
+                orienting.stopJumping(entity);
+              }
+            }
           }
-        }
-      }
-    }
+        });
 
     actions_.pop();
   }
 }
 
+System::Access ControllingSystem::getAccess() const
+{
+  // Input is handed to the OrientingSystem, which changes how bodies move and
+  // which animations they play.
+  Access access;
+  access.exclusive = false;
+
+  access.reads = EntityManager::getSignature<
+    ControllableComponent,
+    OrientableComponent,
+    PonderableComponent>();
+
+  access.writes = EntityManager::getSignature<
+    ControllableComponent,
+    OrientableComponent,
+    PonderableComponent,
+    AnimatableComponent>();
+
+  return access;
+}
+
 void ControllingSystem::input(int key, int action)
 {
   actions_.push(std::make_pair(key, action));
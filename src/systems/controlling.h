@@ -13,6 +13,8 @@ public:
 
   void tick(double dt);
 
+  Access getAccess() const;
+
   void input(int key, int action);
 
   void freeze(id_type entity);
@@ -1,20 +1,84 @@
 #include "mapping.h"
+#include <vector>
+#include <tuple>
+#include <algorithm>
 #include "components/mappable.h"
 #include "systems/realizing.h"
 #include "game.h"
 #include "consts.h"
 
-template <typename Storage>
+/**
+ * A boundary that has been generated but not yet merged with its neighbors.
+ */
+struct PendingBoundary {
+  double axis;
+  double lower;
+  double upper;
+  PonderableComponent::Collision type;
+};
+
 inline void addBoundary(
-  Storage& boundaries,
-  int axis,
-  int lower,
-  int upper,
-  MappableComponent::Boundary::Type type)
+  std::vector<PendingBoundary>& boundaries,
+  double axis,
+  double lower,
+  double upper,
+  PonderableComponent::Collision type)
+{
+  boundaries.push_back({axis, lower, upper, type});
+}
+
+/**
+ * Returns whether a tile blocks movement from every side. An edge of a tile
+ * that is shared with a solid tile can never be touched, because a body would
+ * have to be inside of the solid tile to reach it.
+ */
+inline bool isSolidTile(const MappableComponent& mappable, int x, int y)
 {
-  boundaries.emplace(std::piecewise_construct,
-    std::tie(axis),
-    std::tie(axis, lower, upper, type));
+  if ((x < 0) || (x >= MAP_WIDTH) || (y < 0) || (y >= MAP_HEIGHT))
+  {
+    return false;
+  }
+
+  int tile = mappable.tiles[x + y * MAP_WIDTH];
+
+  return (tile > 0) && (tile < 28) && !((tile >= 5) && (tile <= 7));
+}
+
+/**
+ * Merges colinear boundaries of the same type whose ranges meet end to end,
+ * and adds the result to the index. A body overlaps the merged boundary
+ * exactly when it overlaps one of the original boundaries, so this doesn't
+ * change collision behavior.
+ */
+template <typename Storage>
+inline void mergeBoundaries(
+  std::vector<PendingBoundary>& boundaries,
+  Storage& index)
+{
+  std::stable_sort(
+    std::begin(boundaries),
+    std::end(boundaries),
+    [] (const PendingBoundary& left, const PendingBoundary& right) {
+      return std::tie(left.axis, left.lower) <
+        std::tie(right.axis, right.lower);
+    });
+
+  for (size_t i = 0; i < boundaries.size();)
+  {
+    PendingBoundary merged = boundaries[i];
+
+    for (i++;
+      (i < boundaries.size()) &&
+        (boundaries[i].axis == merged.axis) &&
+        (boundaries[i].type == merged.type) &&
+        (boundaries[i].lower == merged.upper);
+      i++)
+    {
+      merged.upper = boundaries[i].upper;
+    }
+
+    index.add(merged.axis, merged.lower, merged.upper, merged.type);
+  }
 }
 
 void MappingSystem::render(Texture& texture)
@@ -82,106 +146,164 @@ void MappingSystem::generateBoundaries(id_type mapEntity)
   auto& mappable = game_.getEntityManager().
     getComponent<MappableComponent>(mapEntity);
 
-  addBoundary(
-    mappable.leftBoundaries,
+  std::vector<PendingBoundary> leftBoundaries;
+  std::vector<PendingBoundary> rightBoundaries;
+  std::vector<PendingBoundary> upBoundaries;
+  std::vector<PendingBoundary> downBoundaries;
+
+  // Each boundary is recorded both in a list, and in the collision grid.
+  auto addMapEdge = [&] (
+    std::vector<PendingBoundary>& boundaries,
+    Direction dir,
+    int axis,
+    int upper) {
+      addBoundary(
+        boundaries,
+        axis,
+        0,
+        upper,
+        PonderableComponent::Collision::adjacency);
+
+      mappable.collisionGrid.setEdge(
+        dir,
+        axis,
+        0,
+        upper,
+        PonderableComponent::Collision::adjacency);
+    };
+
+  auto addTileFace = [&] (
+    Direction dir,
+    int x,
+    int y,
+    PonderableComponent::Collision type) {
+      mappable.collisionGrid.setFace(dir, x, y, type);
+
+      double lower;
+      double upper;
+      TileCollisionGrid::getFaceRange(dir, x, y, lower, upper);
+
+      double axis = TileCollisionGrid::getFaceAxis(dir, x, y, type);
+
+      switch (dir)
+      {
+        case Direction::left:
+        {
+          addBoundary(leftBoundaries, axis, lower, upper, type);
+
+          break;
+        }
+
+        case Direction::right:
+        {
+          addBoundary(rightBoundaries, axis, lower, upper, type);
+
+          break;
+        }
+
+        case Direction::up:
+        {
+          addBoundary(upBoundaries, axis, lower, upper, type);
+
+          break;
+        }
+
+        case Direction::down:
+        {
+          addBoundary(downBoundaries, axis, lower, upper, type);
+
+          break;
+        }
+      }
+    };
+
+  addMapEdge(
+    leftBoundaries,
+    Direction::left,
     -WALL_GAP,
-    0,
-    MAP_HEIGHT * TILE_HEIGHT,
-    MappableComponent::Boundary::Type::adjacency);
+    MAP_HEIGHT * TILE_HEIGHT);
 
-  addBoundary(
-    mappable.rightBoundaries,
+  addMapEdge(
+    rightBoundaries,
+    Direction::right,
     GAME_WIDTH + WALL_GAP,
-    0,
-    MAP_HEIGHT * TILE_HEIGHT,
-    MappableComponent::Boundary::Type::adjacency);
+    MAP_HEIGHT * TILE_HEIGHT);
 
-  addBoundary(
-    mappable.upBoundaries,
+  addMapEdge(
+    upBoundaries,
+    Direction::up,
     -WALL_GAP,
-    0,
-    GAME_WIDTH,
-    MappableComponent::Boundary::Type::adjacency);
+    GAME_WIDTH);
 
-  addBoundary(
-    mappable.downBoundaries,
+  addMapEdge(
+    downBoundaries,
+    Direction::down,
     MAP_HEIGHT * TILE_HEIGHT + WALL_GAP,
-    0,
-    GAME_WIDTH,
-    MappableComponent::Boundary::Type::adjacency);
+    GAME_WIDTH);
 
-  for (size_t i = 0; i < MAP_WIDTH * MAP_HEIGHT; i++)
+  for (int i = 0; i < MAP_WIDTH * MAP_HEIGHT; i++)
   {
-    size_t x = i % MAP_WIDTH;
-    size_t y = i / MAP_WIDTH;
+    int x = i % MAP_WIDTH;
+    int y = i / MAP_WIDTH;
     int tile = mappable.tiles[i];
 
+    // Which neighbors hide the edges of this tile.
+    bool solidLeft = isSolidTile(mappable, x - 1, y);
+    bool solidRight = isSolidTile(mappable, x + 1, y);
+    bool solidAbove = isSolidTile(mappable, x, y - 1);
+    bool solidBelow = isSolidTile(mappable, x, y + 1);
+
+    PonderableComponent::Collision type;
+
     if ((tile >= 5) && (tile <= 7))
     {
-      addBoundary(
-        mappable.downBoundaries,
-        y * TILE_HEIGHT,
-        x * TILE_WIDTH,
-        (x + 1) * TILE_WIDTH,
-        MappableComponent::Boundary::Type::platform);
+      if (!solidAbove)
+      {
+        addTileFace(
+          Direction::down,
+          x,
+          y,
+          PonderableComponent::Collision::platform);
+      }
+
+      continue;
     } else if ((tile > 0) && (tile < 28))
     {
-      addBoundary(
-        mappable.rightBoundaries,
-        x * TILE_WIDTH,
-        y * TILE_HEIGHT,
-        (y+1) * TILE_HEIGHT,
-        MappableComponent::Boundary::Type::wall);
-
-      addBoundary(
-        mappable.leftBoundaries,
-        (x+1) * TILE_WIDTH,
-        y * TILE_HEIGHT,
-        (y+1) * TILE_HEIGHT,
-        MappableComponent::Boundary::Type::wall);
+      type = PonderableComponent::Collision::wall;
+    } else if (tile == 42)
+    {
+      type = PonderableComponent::Collision::danger;
+    } else {
+      continue;
+    }
 
-      addBoundary(
-        mappable.downBoundaries,
-        y * TILE_HEIGHT,
-        x * TILE_WIDTH,
-        (x+1) * TILE_WIDTH,
-        MappableComponent::Boundary::Type::wall);
+    mappable.collisionGrid.setSolid(x, y, type);
 
-      addBoundary(
-        mappable.upBoundaries,
-        (y+1) * TILE_HEIGHT,
-        x * TILE_WIDTH,
-        (x+1) * TILE_WIDTH,
-        MappableComponent::Boundary::Type::wall);
-    } else if (tile == 42)
+    if (!solidLeft)
     {
-      addBoundary(
-        mappable.rightBoundaries,
-        x * TILE_WIDTH,
-        y * TILE_HEIGHT,
-        (y+1) * TILE_HEIGHT,
-        MappableComponent::Boundary::Type::danger);
+      addTileFace(Direction::right, x, y, type);
+    }
 
-      addBoundary(
-        mappable.leftBoundaries,
-        (x+1) * TILE_WIDTH,
-        y * TILE_HEIGHT,
-        (y+1) * TILE_HEIGHT,
-        MappableComponent::Boundary::Type::danger);
+    if (!solidRight)
+    {
+      addTileFace(Direction::left, x, y, type);
+    }
 
-      addBoundary(
-        mappable.downBoundaries,
-        y * TILE_HEIGHT + 1,
-        x * TILE_WIDTH,
-        (x+1) * TILE_WIDTH,
-        MappableComponent::Boundary::Type::danger);
+    // Because the top of a danger tile is lowered, a body can slide into the
+    // gap from the side even if there is a solid tile above it.
+    if (!solidAbove || (type == PonderableComponent::Collision::danger))
+    {
+      addTileFace(Direction::down, x, y, type);
+    }
 
-      addBoundary(
-        mappable.upBoundaries,
-        (y+1) * TILE_HEIGHT,
-        x * TILE_WIDTH,
-        (x+1) * TILE_WIDTH,
-        MappableComponent::Boundary::Type::danger);
+    if (!solidBelow)
+    {
+      addTileFace(Direction::up, x, y, type);
     }
   }
+
+  mergeBoundaries(leftBoundaries, mappable.leftBoundaries);
+  mergeBoundaries(rightBoundaries, mappable.rightBoundaries);
+  mergeBoundaries(upBoundaries, mappable.upBoundaries);
+  mergeBoundaries(downBoundaries, mappable.downBoundaries);
 }
@@ -10,6 +10,18 @@ public:
   {
   }
 
+  /**
+   * This system does not tick, so it never conflicts with other systems.
+   */
+  Access getAccess() const
+  {
+    Access access;
+    access.exclusive = false;
+    access.ticks = false;
+
+    return access;
+  }
+
   void render(Texture& texture);
 
   void generateBoundaries(id_type mapEntity);
@@ -8,23 +8,28 @@
 
 void OrientingSystem::tick(double)
 {
-  auto entities = game_.getEntityManager().getEntitiesWithComponents<
+  game_.getEntityManager().each<
     OrientableComponent,
-    PonderableComponent>();
-
-  for (id_type entity : entities)
-  {
-    auto& orientable = game_.getEntityManager().
-      getComponent<OrientableComponent>(entity);
+    PonderableComponent>(
+      [] (
+        id_type,
+        OrientableComponent& orientable,
+        PonderableComponent& ponderable) {
+        if (orientable.isJumping() && (ponderable.vel.y() > 0))
+        {
+          orientable.setJumping(false);
+        }
+      });
+}
 
-    auto& ponderable = game_.getEntityManager().
-      getComponent<PonderableComponent>(entity);
+System::Access OrientingSystem::getAccess() const
+{
+  Access access;
+  access.exclusive = false;
+  access.reads = EntityManager::getSignature<PonderableComponent>();
+  access.writes = EntityManager::getSignature<OrientableComponent>();
 
-    if (orientable.isJumping() && (ponderable.vel.y() > 0))
-    {
-      orientable.setJumping(false);
-    }
-  }
+  return access;
 }
 
 void OrientingSystem::moveLeft(id_type entity)
@@ -12,6 +12,8 @@ public:
 
   void tick(double dt);
 
+  Access getAccess() const;
+
   void moveLeft(id_type entity);
 
   void moveRight(id_type entity);
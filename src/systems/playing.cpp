@@ -50,6 +50,7 @@ void PlayingSystem::initPlayer()
   auto& ponderable = game_.getEntityManager().
     getComponent<PonderableComponent>(player);
   ponderable.accel.x() = 720;
+  ponderable.layer = PonderableComponent::Layer::player;
 
   game_.getEntityManager().emplaceComponent<ControllableComponent>(player);
   game_.getEntityManager().emplaceComponent<OrientableComponent>(player);
@@ -98,6 +99,7 @@ void PlayingSystem::changeMap(
   pondering.unferry(player);
 
   transformable.pos = warpPos;
+  pondering.refreshBody(player);
 
   if (realizing.getActivePlayer() == player)
   {
@@ -134,6 +136,14 @@ void PlayingSystem::die(id_type player)
       playable.checkpointMapId,
       playable.checkpointPos);
 
+    // Fetch the components again, because references into the component pools
+    // are not guaranteed to outlive the scheduled delay.
+    auto& animatable = game_.getEntityManager().
+      getComponent<AnimatableComponent>(player);
+
+    auto& ponderable = game_.getEntityManager().
+      getComponent<PonderableComponent>(player);
+
     animatable.frozen = false;
     animatable.flickering = false;
     ponderable.frozen = false;
@@ -1,6 +1,8 @@
 #include "pondering.h"
 #include <queue>
 #include <algorithm>
+#include <cmath>
+#include <stdexcept>
 #include "game.h"
 #include "components/ponderable.h"
 #include "components/transformable.h"
@@ -12,27 +14,203 @@
 #include "systems/realizing.h"
 #include "systems/scripting.h"
 #include "consts.h"
+#include "fixed_point.h"
 
 void PonderingSystem::tick(double dt)
 {
-  auto entities = game_.getEntityManager().getEntitiesWithComponents<
+  // Bodies may have been moved, created or destroyed since the last tick.
+  grid_.clear();
+  triggers_.clear();
+  triggerLayers_ = PonderableComponent::Layer::none;
+
+  // Gather the bodies that will move this tick, so that they can all be
+  // accelerated at once before any collisions are processed.
+  bodies_.clear();
+  sleepingBodies_ = 0;
+
+  game_.getEntityManager().each<
     PonderableComponent,
-    TransformableComponent>();
+    TransformableComponent>(
+      [&] (
+        id_type entity,
+        PonderableComponent& ponderable,
+        TransformableComponent& transformable) {
+        // Snap bodies onto the fixed-point grid, in case anything outside of
+        // the PonderingSystem moved them off of it.
+        if (ponderable.active && (arithmetic_ == Arithmetic::fixed))
+        {
+          transformable.pos = quantize(transformable.pos);
+          ponderable.vel = quantize(ponderable.vel);
+          ponderable.accel = quantize(ponderable.accel);
+          ponderable.targetVel = quantize(ponderable.targetVel);
+        }
 
-  for (id_type entity : entities)
-  {
-    auto& ponderable = game_.getEntityManager().
-      getComponent<PonderableComponent>(entity);
+        updateBroadphase(entity, ponderable, transformable);
 
-    // We will recursively process ferried bodies after their ferries have been
-    // processed, so hold off on processing ferried bodies at the top level.
-    if (ponderable.ferried)
-    {
-      continue;
-    }
+        if (!ponderable.active)
+        {
+          ponderable.asleep = false;
+
+          return;
+        }
+
+        RestState& rest = getRestState(entity);
+
+        // Wake sleeping bodies that were disturbed since the last tick. If
+        // anything else changed the body's motion, it will no longer match
+        // what it was when it fell asleep.
+        if (ponderable.asleep)
+        {
+          if (rest.woken || !rest.matches(ponderable, transformable))
+          {
+            ponderable.asleep = false;
+            rest.restingTicks = 0;
+          } else {
+            sleepingBodies_++;
+
+            return;
+          }
+        }
+
+        rest.woken = false;
+        rest.record(ponderable, transformable);
+
+        if (!ponderable.frozen)
+        {
+          bodies_.add(
+            ponderable.vel,
+            ponderable.accel,
+            ponderable.targetVel);
+        }
+      });
 
-    tickBody(entity, dt);
+  if (arithmetic_ == Arithmetic::fixed)
+  {
+    bodies_.integrateFixed(dt);
+  } else {
+    bodies_.integrate(dt);
   }
+
+  // The bodies are visited in the same order as they were gathered.
+  size_t bodyIndex = 0;
+
+  game_.getEntityManager().each<
+    PonderableComponent,
+    TransformableComponent>(
+      [&] (
+        id_type,
+        PonderableComponent& ponderable,
+        TransformableComponent&) {
+        if (ponderable.active && !ponderable.asleep && !ponderable.frozen)
+        {
+          ponderable.vel = bodies_.getVelocity(bodyIndex++);
+        }
+      });
+
+  game_.getEntityManager().each<
+    PonderableComponent,
+    TransformableComponent>(
+      [&] (
+        id_type entity,
+        PonderableComponent& ponderable,
+        TransformableComponent&) {
+        // Ferried bodies are processed after their ferries have been
+        // processed, so hold off on processing ferried bodies at the top level.
+        if (ponderable.ferried)
+        {
+          return;
+        }
+
+        tickFerryTree(entity, dt);
+      });
+
+  detectTriggerContacts();
+  dispatchContacts();
+
+  // Put bodies to sleep once they have stopped changing. Ferries and their
+  // passengers move each other, and orientable bodies are driven by input, so
+  // those are kept awake.
+  game_.getEntityManager().each<
+    PonderableComponent,
+    TransformableComponent>(
+      [&] (
+        id_type entity,
+        PonderableComponent& ponderable,
+        TransformableComponent& transformable) {
+        if (!ponderable.active || ponderable.asleep)
+        {
+          return;
+        }
+
+        RestState& rest = getRestState(entity);
+
+        if (ponderable.ferried ||
+          !ponderable.passengers.empty() ||
+          rest.woken ||
+          !rest.matches(ponderable, transformable) ||
+          game_.getEntityManager().hasComponent<OrientableComponent>(entity))
+        {
+          rest.restingTicks = 0;
+
+          return;
+        }
+
+        rest.restingTicks++;
+
+        if (rest.restingTicks >= TICKS_BEFORE_SLEEP)
+        {
+          ponderable.asleep = true;
+        }
+      });
+}
+
+void PonderingSystem::RestState::record(
+  const PonderableComponent& ponderable,
+  const TransformableComponent& transformable)
+{
+  pos = transformable.pos;
+  vel = ponderable.vel;
+  accel = ponderable.accel;
+  targetVel = ponderable.targetVel;
+  frozen = ponderable.frozen;
+  collidable = ponderable.collidable;
+}
+
+bool PonderingSystem::RestState::matches(
+  const PonderableComponent& ponderable,
+  const TransformableComponent& transformable) const
+{
+  return (pos.x() == transformable.pos.x()) &&
+    (pos.y() == transformable.pos.y()) &&
+    (vel.x() == ponderable.vel.x()) &&
+    (vel.y() == ponderable.vel.y()) &&
+    (accel.x() == ponderable.accel.x()) &&
+    (accel.y() == ponderable.accel.y()) &&
+    (targetVel.x() == ponderable.targetVel.x()) &&
+    (targetVel.y() == ponderable.targetVel.y()) &&
+    (frozen == ponderable.frozen) &&
+    (collidable == ponderable.collidable);
+}
+
+System::Access PonderingSystem::getAccess() const
+{
+  // Bodies land, fall, warp and die as they move, which reaches into most of
+  // the other systems, and contacts run scripts. The tick therefore has to be
+  // exclusive; the sets below only record what it touches directly.
+  Access access;
+  access.exclusive = true;
+
+  access.reads = EntityManager::getSignature<
+    PonderableComponent,
+    TransformableComponent,
+    MappableComponent>();
+
+  access.writes = EntityManager::getSignature<
+    PonderableComponent,
+    TransformableComponent,
+    OrientableComponent>();
+
+  return access;
 }
 
 void PonderingSystem::initializeBody(
@@ -47,6 +225,9 @@ void PonderingSystem::initializeBody(
     ponderable.targetVel.y() = TERMINAL_VELOCITY;
     ponderable.accel.y() = NORMAL_GRAVITY;
   }
+
+  // The body's slot may have belonged to an entity that was deleted.
+  getRestState(entity) = RestState();
 }
 
 void PonderingSystem::initPrototype(id_type prototype)
@@ -65,6 +246,10 @@ void PonderingSystem::initPrototype(id_type prototype)
   ponderable.collidable = true;
   ponderable.ferried = false;
   ponderable.passengers.clear();
+  ponderable.asleep = false;
+  getRestState(prototype) = RestState();
+
+  refreshBody(prototype);
 }
 
 void PonderingSystem::unferry(id_type entity)
@@ -83,74 +268,68 @@ void PonderingSystem::unferry(id_type entity)
   }
 }
 
-void PonderingSystem::tickBody(
-  id_type entity,
+void PonderingSystem::tickFerryTree(
+  id_type root,
   double dt)
 {
-  auto& ponderable = game_.getEntityManager().
-    getComponent<PonderableComponent>(entity);
-
-  if (!ponderable.active)
-  {
-    return;
-  }
-
-  auto& transformable = game_.getEntityManager().
-    getComponent<TransformableComponent>(entity);
-
-  // Accelerate
-  if (!ponderable.frozen)
+  // Walk the tree depth first, so that every body is ticked after its ferry.
+  // Passengers are pushed in reverse so that siblings are ticked in ID order.
+  // A body's passengers are read after it has been ticked, because ticking it
+  // may have picked up or dropped passengers.
+  tickStack_.clear();
+  tickStack_.push_back(root);
+
+  while (!tickStack_.empty())
   {
-    // Determine the effective acceleration, which should be in the direction of
-    // the target velocity.
-    vec2d effAcc = ponderable.accel;
+    id_type entity = tickStack_.back();
+    tickStack_.pop_back();
 
-    if (ponderable.vel.x() == ponderable.targetVel.x())
-    {
-      effAcc.x() = 0.0;
-    }
-    else if ((ponderable.accel.x() > 0 &&
-              ponderable.targetVel.x() < ponderable.vel.x()) ||
-             (ponderable.accel.x() < 0 &&
-              ponderable.targetVel.x() > ponderable.vel.x()))
+    if (!tickBody(entity, dt))
     {
-      effAcc.x() = -effAcc.x();
+      continue;
     }
 
-    if (ponderable.vel.y() == ponderable.targetVel.y())
-    {
-      effAcc.y() = 0.0;
-    }
-    else if ((ponderable.accel.y() > 0 &&
-              ponderable.targetVel.y() < ponderable.vel.y()) ||
-             (ponderable.accel.y() < 0 &&
-              ponderable.targetVel.y() > ponderable.vel.y()))
-    {
-      effAcc.y() = -effAcc.y();
-    }
+    auto& ponderable = game_.getEntityManager().
+      getComponent<PonderableComponent>(entity);
 
-    // Accelerate
-    ponderable.vel += effAcc * dt;
+    tickStack_.insert(
+      std::end(tickStack_),
+      ponderable.passengers.rbegin(),
+      ponderable.passengers.rend());
+  }
+}
 
-    // If the velocity crossed the target velocity, set it to the target
-    if ((effAcc.x() > 0 && ponderable.vel.x() > ponderable.targetVel.x()) ||
-        (effAcc.x() < 0 && ponderable.vel.x() < ponderable.targetVel.x()))
-    {
-      ponderable.vel.x() = ponderable.targetVel.x();
-    }
+bool PonderingSystem::tickBody(
+  id_type entity,
+  double dt)
+{
+  auto& ponderable = game_.getEntityManager().
+    getComponent<PonderableComponent>(entity);
 
-    if ((effAcc.y() > 0 && ponderable.vel.y() > ponderable.targetVel.y()) ||
-        (effAcc.y() < 0 && ponderable.vel.y() < ponderable.targetVel.y()))
-    {
-      ponderable.vel.y() = ponderable.targetVel.y();
-    }
+  if (!ponderable.active || ponderable.asleep)
+  {
+    return false;
   }
 
+  auto& transformable = game_.getEntityManager().
+    getComponent<TransformableComponent>(entity);
+
   // Move
   vec2d newPos = transformable.pos;
 
-  if (!ponderable.frozen)
+  if (ponderable.frozen)
+  {
+    // Frozen bodies stay where they are.
+  } else if (arithmetic_ == Arithmetic::fixed)
   {
+    fixed_type fixedDt = toFixedTime(dt);
+
+    newPos.x() = fromFixed(
+      toFixed(newPos.x()) + scaleByTime(toFixed(ponderable.vel.x()), fixedDt));
+
+    newPos.y() = fromFixed(
+      toFixed(newPos.y()) + scaleByTime(toFixed(ponderable.vel.y()), fixedDt));
+  } else {
     newPos += ponderable.vel * dt;
   }
 
@@ -201,6 +380,8 @@ void PonderingSystem::tickBody(
       ponderable.ferrySide = Direction::up;
 
       ferryPonder.passengers.insert(entity);
+
+      wakeBody(result.groundEntity);
     } else if (ponderable.ferried)
     {
       // The body is no longer being ferried
@@ -208,108 +389,483 @@ void PonderingSystem::tickBody(
     }
   }
 
-  // Handle ferry passengers
-  std::set<id_type> passengers = ponderable.passengers;
+  return true;
+}
 
-  for (id_type passenger : passengers)
+void PonderingSystem::refreshBody(id_type entity)
+{
+  if (game_.getEntityManager().hasComponent<PonderableComponent>(entity) &&
+    game_.getEntityManager().hasComponent<TransformableComponent>(entity))
   {
-    tickBody(passenger, dt);
+    auto& ponderable = game_.getEntityManager().
+      getComponent<PonderableComponent>(entity);
+
+    auto& transformable = game_.getEntityManager().
+      getComponent<TransformableComponent>(entity);
+
+    updateBroadphase(entity, ponderable, transformable);
+
+    wakeBody(entity);
+  } else {
+    grid_.remove(entity);
+    triggers_.remove(entity);
   }
 }
 
-PonderingSystem::CollisionResult PonderingSystem::moveBody(
+/**
+ * Trigger volumes are bodies that only exist to be touched. They never block
+ * movement, so they are found by overlap rather than by sweeping.
+ */
+inline bool isTrigger(const PonderableComponent& ponderable)
+{
+  return (ponderable.colliderType == PonderableComponent::Collision::event);
+}
+
+void PonderingSystem::updateBroadphase(
   id_type entity,
-  vec2d newPos)
+  const PonderableComponent& ponderable,
+  const TransformableComponent& transformable)
 {
-  auto& ponderable = game_.getEntityManager().
-    getComponent<PonderableComponent>(entity);
+  if (isTrigger(ponderable))
+  {
+    triggers_.update(entity, transformable.pos, transformable.size);
+    grid_.remove(entity);
 
-  CollisionResult result;
+    triggerLayers_ |= ponderable.layer;
+  } else {
+    grid_.update(entity, transformable.pos, transformable.size);
+    triggers_.remove(entity);
+  }
+}
 
-  if (ponderable.collidable)
+void PonderingSystem::detectTriggerContacts()
+{
+  if (triggerLayers_ == PonderableComponent::Layer::none)
   {
-    result = detectCollisions(entity, newPos);
-  } else {
-    result.pos = newPos;
+    return;
   }
 
-  if (!ponderable.frozen)
+  game_.getEntityManager().each<
+    PonderableComponent,
+    TransformableComponent>(
+      [&] (
+        id_type entity,
+        PonderableComponent& ponderable,
+        TransformableComponent& transformable) {
+        if (!ponderable.active ||
+          !ponderable.collidable ||
+          isTrigger(ponderable) ||
+          ((ponderable.mask & triggerLayers_) == 0))
+        {
+          return;
+        }
+
+        vec2d lower = transformable.pos;
+        vec2d upper = transformable.pos + vec2d(transformable.size);
+
+        // A trigger that spans several cells is found more than once, but the
+        // contact set ignores the duplicates.
+        candidates_.clear();
+        triggers_.query(lower, upper, candidates_);
+
+        for (id_type trigger : candidates_)
+        {
+          auto& triggerPonder = game_.getEntityManager().
+            getComponent<PonderableComponent>(trigger);
+
+          if (!triggerPonder.active ||
+            !triggerPonder.collidable ||
+            !ponderable.canCollideWith(triggerPonder))
+          {
+            continue;
+          }
+
+          auto& triggerTrans = game_.getEntityManager().
+            getComponent<TransformableComponent>(trigger);
+
+          // Bodies that are merely touching a trigger don't count.
+          if ((triggerTrans.pos.x() < upper.x()) &&
+            (triggerTrans.pos.x() + triggerTrans.size.w() > lower.x()) &&
+            (triggerTrans.pos.y() < upper.y()) &&
+            (triggerTrans.pos.y() + triggerTrans.size.h() > lower.y()))
+          {
+            contacts_.emplace_back(
+              entity,
+              trigger,
+              triggerPonder.colliderType);
+          }
+        }
+      });
+}
+
+PonderingSystem::EnvironmentBackend PonderingSystem::parseEnvironmentBackend(
+  const std::string& name)
+{
+  if (name == "tiles")
   {
-    auto& transformable = game_.getEntityManager().
-      getComponent<TransformableComponent>(entity);
+    return EnvironmentBackend::tiles;
+  } else if (name == "boundaries")
+  {
+    return EnvironmentBackend::boundaries;
+  }
+
+  throw std::invalid_argument("Unknown collision backend: " + name);
+}
+
+std::string PonderingSystem::getEnvironmentBackendName(
+  EnvironmentBackend backend)
+{
+  return (backend == EnvironmentBackend::tiles) ? "tiles" : "boundaries";
+}
 
-    vec2d delta = result.pos - transformable.pos;
+PonderingSystem::Arithmetic PonderingSystem::parseArithmetic(
+  const std::string& name)
+{
+  if (name == "fixed")
+  {
+    return Arithmetic::fixed;
+  } else if (name == "floating")
+  {
+    return Arithmetic::floating;
+  }
+
+  throw std::invalid_argument("Unknown arithmetic: " + name);
+}
+
+std::string PonderingSystem::getArithmeticName(Arithmetic arithmetic)
+{
+  return (arithmetic == Arithmetic::fixed) ? "fixed" : "floating";
+}
+
+void PonderingSystem::setProfiler(Profiler* profiler)
+{
+  profiler_ = profiler;
+
+  if (profiler_)
+  {
+    detectSection_ = profiler_->addSection("PonderingSystem::detectCollisions");
+  }
+}
+
+void PonderingSystem::wakeBody(id_type entity)
+{
+  if (game_.getEntityManager().hasComponent<PonderableComponent>(entity))
+  {
+    getRestState(entity).woken = true;
+  }
+}
 
-    // Move.
-    transformable.pos = result.pos;
+void PonderingSystem::wakeTouchingBodies(
+  id_type entity,
+  const vec2d& lower,
+  const vec2d& upper)
+{
+  wakeCandidates_.clear();
+  grid_.query(lower, upper, wakeCandidates_);
 
-    // Stop if the entity hit a wall.
-    if (result.blockedHoriz)
+  for (id_type candidate : wakeCandidates_)
+  {
+    if (candidate == entity)
     {
-      ponderable.vel.x() = 0.0;
+      continue;
     }
 
-    if (result.blockedVert)
+    auto& candidatePonder = game_.getEntityManager().
+      getComponent<PonderableComponent>(candidate);
+
+    if (!candidatePonder.asleep)
     {
-      ponderable.vel.y() = 0.0;
+      continue;
     }
 
-    // Move ferry passengers by the appropriate amount.
-    auto passengers = ponderable.passengers;
+    auto& candidateTrans = game_.getEntityManager().
+      getComponent<TransformableComponent>(candidate);
 
-    for (id_type passenger : passengers)
+    // Bodies that are merely touching still count.
+    if ((candidateTrans.pos.x() <= upper.x()) &&
+      (candidateTrans.pos.x() + candidateTrans.size.w() >= lower.x()) &&
+      (candidateTrans.pos.y() <= upper.y()) &&
+      (candidateTrans.pos.y() + candidateTrans.size.h() >= lower.y()))
     {
-      auto& passTrans = game_.getEntityManager().
-        getComponent<TransformableComponent>(passenger);
+      getRestState(candidate).woken = true;
+    }
+  }
+}
 
-      moveBody(passenger, passTrans.pos + delta);
+void PonderingSystem::dispatchContacts()
+{
+  contactEvents_.clear();
+
+  std::sort(std::begin(contacts_), std::end(contacts_));
+  contacts_.erase(
+    std::unique(std::begin(contacts_), std::end(contacts_)),
+    std::end(contacts_));
+
+  auto addEvent = [&] (ContactEvent::Phase phase, const contact_type& contact) {
+    contactEvents_.push_back({
+      phase,
+      std::get<0>(contact),
+      std::get<1>(contact),
+      std::get<2>(contact)});
+  };
+
+  // Both lists are sorted, so walk them together to find which contacts are
+  // new, which carried over, and which ended.
+  auto current = std::begin(contacts_);
+  auto previous = std::begin(previousContacts_);
+
+  while ((current != std::end(contacts_)) ||
+    (previous != std::end(previousContacts_)))
+  {
+    if ((previous == std::end(previousContacts_)) ||
+      ((current != std::end(contacts_)) && (*current < *previous)))
+    {
+      addEvent(ContactEvent::Phase::begin, *current);
+      current++;
+    } else if ((current == std::end(contacts_)) || (*previous < *current))
+    {
+      addEvent(ContactEvent::Phase::end, *previous);
+      previous++;
+    } else {
+      addEvent(ContactEvent::Phase::persist, *current);
+      current++;
+      previous++;
     }
+  }
+
+  std::swap(previousContacts_, contacts_);
+  contacts_.clear();
 
-    // Move to an adjacent map, if necessary
-    if (result.adjacentlyWarping)
+  // Only the start of a contact has an effect, so that standing in a trigger
+  // or a hazard doesn't repeat it every tick. This is fixed: scripts can't ask
+  // to hear about the other phases.
+  for (const ContactEvent& contact : contactEvents_)
+  {
+    if ((contact.phase != ContactEvent::Phase::begin) ||
+      !game_.getEntityManager().isValid(contact.entity) ||
+      !game_.getEntityManager().isValid(contact.collider) ||
+      !game_.getEntityManager().
+        hasComponent<PlayableComponent>(contact.entity))
     {
-      vec2d warpPos = result.pos;
+      continue;
+    }
 
-      switch (result.adjWarpDir)
+    switch (contact.type)
+    {
+      case PonderableComponent::Collision::danger:
       {
-        case Direction::left:
-        {
-          warpPos.x() = GAME_WIDTH + WALL_GAP - transformable.size.w();
+        game_.getSystemManager().getSystem<PlayingSystem>().
+          die(contact.entity);
 
-          break;
-        }
+        break;
+      }
 
-        case Direction::right:
-        {
-          warpPos.x() = -WALL_GAP;
+      case PonderableComponent::Collision::event:
+      {
+        game_.getSystemManager().getSystem<ScriptingSystem>().
+          onTouch(contact.collider, contact.entity);
 
-          break;
-        }
+        break;
+      }
 
-        case Direction::up:
-        {
-          warpPos.y() = MAP_HEIGHT * TILE_HEIGHT - transformable.size.h();
+      default:
+      {
+        break;
+      }
+    }
+  }
+}
 
-          break;
-        }
+PonderingSystem::RestState& PonderingSystem::getRestState(id_type entity)
+{
+  EntityHandle::index_type slot = EntityHandle::getIndex(entity);
 
-        case Direction::down:
-        {
-          warpPos.y() = -WALL_GAP;
+  if (slot >= restStates_.size())
+  {
+    restStates_.resize(slot + 1);
+  }
 
-          break;
+  return restStates_[slot];
+}
+
+PonderingSystem::CollisionResult PonderingSystem::moveBody(
+  id_type entity,
+  vec2d newPos)
+{
+  // Passengers are moved depth first, by however far their ferry moved, and
+  // each ferry finishes moving (which may mean warping to another map) only
+  // after all of its passengers have moved. The frames above the base belong
+  // to this call.
+  size_t base = moveStack_.size();
+  moveStack_.push_back({entity, newPos, false});
+
+  CollisionResult rootResult;
+
+  while (moveStack_.size() > base)
+  {
+    size_t top = moveStack_.size() - 1;
+
+    if (!moveStack_[top].expanded)
+    {
+      MoveFrame& frame = moveStack_[top];
+      frame.expanded = true;
+
+      id_type body = frame.entity;
+      vec2d target = frame.target;
+
+      if (frame.relative)
+      {
+        target += game_.getEntityManager().
+          getComponent<TransformableComponent>(body).pos;
+      }
+
+      vec2d delta;
+      frame.moved = moveBodyAlone(body, target, frame.result, delta);
+
+      if (frame.moved)
+      {
+        // Pushing onto the stack invalidates the reference to the frame.
+        auto& ponderable = game_.getEntityManager().
+          getComponent<PonderableComponent>(body);
+
+        for (auto it = ponderable.passengers.rbegin();
+          it != ponderable.passengers.rend();
+          it++)
+        {
+          moveStack_.push_back({*it, delta, true});
         }
       }
+    } else {
+      MoveFrame frame = moveStack_[top];
+      moveStack_.pop_back();
 
-      game_.getSystemManager().getSystem<PlayingSystem>().
-        changeMap(
-          entity,
-          result.adjWarpMapId,
-          warpPos);
+      if (frame.moved && frame.result.adjacentlyWarping)
+      {
+        warpBody(frame.entity, frame.result);
+      }
+
+      if (moveStack_.size() == base)
+      {
+        rootResult = frame.result;
+      }
     }
   }
 
-  return result;
+  return rootResult;
+}
+
+bool PonderingSystem::moveBodyAlone(
+  id_type entity,
+  vec2d newPos,
+  CollisionResult& result,
+  vec2d& delta)
+{
+  auto& ponderable = game_.getEntityManager().
+    getComponent<PonderableComponent>(entity);
+
+  if (ponderable.collidable)
+  {
+    if (profiler_)
+    {
+      ProfileScope scope(*profiler_, detectSection_);
+
+      result = detectCollisions(entity, newPos);
+    } else {
+      result = detectCollisions(entity, newPos);
+    }
+  } else {
+    result.pos = newPos;
+  }
+
+  if (ponderable.frozen)
+  {
+    return false;
+  }
+
+  auto& transformable = game_.getEntityManager().
+    getComponent<TransformableComponent>(entity);
+
+  delta = result.pos - transformable.pos;
+
+  // Wake any sleeping bodies near the path of the move.
+  if ((sleepingBodies_ > 0) &&
+    ((delta.x() != 0.0) || (delta.y() != 0.0)))
+  {
+    wakeTouchingBodies(
+      entity,
+      vec2d(
+        std::min(transformable.pos.x(), result.pos.x()),
+        std::min(transformable.pos.y(), result.pos.y())),
+      vec2d(
+        std::max(transformable.pos.x(), result.pos.x()) +
+          transformable.size.w(),
+        std::max(transformable.pos.y(), result.pos.y()) +
+          transformable.size.h()));
+  }
+
+  // Move.
+  transformable.pos = result.pos;
+  updateBroadphase(entity, ponderable, transformable);
+
+  // Stop if the entity hit a wall.
+  if (result.blockedHoriz)
+  {
+    ponderable.vel.x() = 0.0;
+  }
+
+  if (result.blockedVert)
+  {
+    ponderable.vel.y() = 0.0;
+  }
+
+  return true;
+}
+
+void PonderingSystem::warpBody(
+  id_type entity,
+  const CollisionResult& result)
+{
+  auto& transformable = game_.getEntityManager().
+    getComponent<TransformableComponent>(entity);
+
+  vec2d warpPos = result.pos;
+
+  switch (result.adjWarpDir)
+  {
+    case Direction::left:
+    {
+      warpPos.x() = GAME_WIDTH + WALL_GAP - transformable.size.w();
+
+      break;
+    }
+
+    case Direction::right:
+    {
+      warpPos.x() = -WALL_GAP;
+
+      break;
+    }
+
+    case Direction::up:
+    {
+      warpPos.y() = MAP_HEIGHT * TILE_HEIGHT - transformable.size.h();
+
+      break;
+    }
+
+    case Direction::down:
+    {
+      warpPos.y() = -WALL_GAP;
+
+      break;
+    }
+  }
+
+  game_.getSystemManager().getSystem<PlayingSystem>().
+    changeMap(
+      entity,
+      result.adjWarpMapId,
+      warpPos);
 }
 
 namespace CollisionParams {
@@ -346,6 +902,17 @@ namespace CollisionParams {
     {
       return right < left;
     }
+
+    static const int Step = -1;
+
+    /**
+     * The tile whose face lies at the given axis. Faces in this direction are
+     * on the far side of their tiles.
+     */
+    inline static int FaceTile(double axis, int tileSize)
+    {
+      return static_cast<int>(std::ceil(axis / tileSize)) - 1;
+    }
   };
 
   template <typename HorizVert>
@@ -380,6 +947,17 @@ namespace CollisionParams {
     {
       return left < right;
     }
+
+    static const int Step = 1;
+
+    /**
+     * The tile whose face lies at the given axis. Faces in this direction are
+     * on the near side of their tiles.
+     */
+    inline static int FaceTile(double axis, int tileSize)
+    {
+      return static_cast<int>(std::floor(axis / tileSize));
+    }
   };
 
   template <size_t Axis, size_t NonAxis>
@@ -406,6 +984,20 @@ namespace CollisionParams {
       return pos.coords[NonAxis] + size.coords[NonAxis];
     }
 
+    static const int AxisTileSize = (Axis == 0) ? TILE_WIDTH : TILE_HEIGHT;
+    static const int AxisTiles = (Axis == 0) ? MAP_WIDTH : MAP_HEIGHT;
+    static const int NonAxisTileSize = (Axis == 0) ? TILE_HEIGHT : TILE_WIDTH;
+    static const int NonAxisTiles = (Axis == 0) ? MAP_HEIGHT : MAP_WIDTH;
+
+    inline static vec2i TileCoords(int axisTile, int nonAxisTile)
+    {
+      vec2i coords;
+      coords.coords[Axis] = axisTile;
+      coords.coords[NonAxis] = nonAxisTile;
+
+      return coords;
+    }
+
   };
 
   using Horizontal = HorizVert<0, 1>;
@@ -471,50 +1063,540 @@ namespace CollisionParams {
   class Down : public DetectCollisions<Direction::down, Asc<Vertical>> {
   public:
 
-    inline static const MappableComponent::asc_boundaries_type& MapBoundaries(
-      const MappableComponent& mappable)
-    {
-      return mappable.downBoundaries;
-    }
-  };
-};
+    inline static const MappableComponent::asc_boundaries_type& MapBoundaries(
+      const MappableComponent& mappable)
+    {
+      return mappable.downBoundaries;
+    }
+  };
+};
+
+inline int clampTile(int tile, int numTiles)
+{
+  return std::max(0, std::min(tile, numTiles - 1));
+}
+
+PonderingSystem::CollisionResult PonderingSystem::detectCollisions(
+  id_type entity,
+  vec2d newPos)
+{
+  auto& transformable = game_.getEntityManager().
+    getComponent<TransformableComponent>(entity);
+
+  auto& ponderable = game_.getEntityManager().
+    getComponent<PonderableComponent>(entity);
+
+  CollisionResult result;
+
+  auto detectHorizontal = [&] () {
+    if (result.pos.x() < transformable.pos.x())
+    {
+      detectCollisionsInDirection<CollisionParams::Left>(entity, result);
+    } else if (result.pos.x() > transformable.pos.x())
+    {
+      detectCollisionsInDirection<CollisionParams::Right>(entity, result);
+    }
+  };
+
+  auto detectVertical = [&] () {
+    if (result.pos.y() < transformable.pos.y())
+    {
+      detectCollisionsInDirection<CollisionParams::Up>(entity, result);
+    } else if (result.pos.y() > transformable.pos.y())
+    {
+      detectCollisionsInDirection<CollisionParams::Down>(entity, result);
+    }
+  };
+
+  // Each axis is swept separately. For a diagonal move, sweeping them in a
+  // fixed order lets a fast body clip a corner that it should have hit, or
+  // catch on one that it should have cleared, so the axis that the body first
+  // touches something on along its straight path is swept first, level with
+  // where the body was at that moment. Ferries keep the fixed order, because
+  // their passengers only pretend to move during the sweeps.
+  //
+  // A body that is already resting on a floor or against a ceiling touches it
+  // straight away. That isn't a hit in the middle of the path, and sweeping
+  // vertically first would keep a body that walks off a ledge on the ground
+  // for a tick, so it keeps the fixed order too.
+  double firstY = transformable.pos.y();
+
+  if ((newPos.x() != transformable.pos.x()) &&
+    (newPos.y() != transformable.pos.y()) &&
+    ponderable.passengers.empty())
+  {
+    bool horizontal;
+    double time;
+    double crossAxis;
+
+    if (!findFirstImpact(entity, newPos, horizontal, time, crossAxis))
+    {
+      result.pos = newPos;
+
+      return result;
+    }
+
+    if (!horizontal && (time > 0.0))
+    {
+      result.pos.x() = crossAxis;
+      result.pos.y() = newPos.y();
+
+      detectVertical();
+
+      if (!result.stopProcessing)
+      {
+        result.pos.x() = newPos.x();
+        result.touchedWall = false;
+
+        detectHorizontal();
+      }
+
+      return result;
+    }
+
+    if (horizontal)
+    {
+      firstY = crossAxis;
+    }
+  }
+
+  result.pos.x() = newPos.x();
+  result.pos.y() = firstY;
+
+  // Find horizontal collisions.
+  detectHorizontal();
+
+  // Find vertical collisions
+  if (!result.stopProcessing)
+  {
+    result.pos.y() = newPos.y();
+    result.touchedWall = false;
+
+    detectVertical();
+  }
+
+  return result;
+}
+
+/**
+ * Finds the coordinate that is the fraction num / den of the way from one
+ * coordinate to another. With fixed-point arithmetic this is done with
+ * integers, so that the result can't depend on whether the compiler fuses the
+ * multiply and add.
+ */
+inline double interpolate(
+  double from,
+  double to,
+  double num,
+  double den,
+  bool fixedPoint)
+{
+  if (fixedPoint)
+  {
+    fixed_type fixedFrom = toFixed(from);
+
+    return fromFixed(
+      fixedFrom +
+        divideRounded(
+          (toFixed(to) - fixedFrom) * toFixed(num),
+          toFixed(den)));
+  }
+
+  return from + (to - from) * (num / den);
+}
+
+/**
+ * Finds when a box moving in a straight line first touches a face that lies
+ * across the axis of the given direction, as a fraction of the move, and
+ * where the box is on the other axis at that moment. Faces behind the box,
+ * and faces that the box passes beside, are never touched.
+ */
+template <typename Param>
+inline bool findFaceImpact(
+  const vec2d& from,
+  const vec2d& to,
+  const vec2i& size,
+  double faceAxis,
+  double lower,
+  double upper,
+  bool fixedPoint,
+  double& time,
+  double& crossAxis)
+{
+  double fromAxis = Param::EntityAxis(from, size);
+  double toAxis = Param::EntityAxis(to, size);
+
+  if (Param::Closer(faceAxis, fromAxis) ||
+    !Param::AtLeastInAxisSweep(faceAxis, toAxis))
+  {
+    return false;
+  }
+
+  time = (faceAxis - fromAxis) / (toAxis - fromAxis);
+
+  double nonLower = interpolate(
+    Param::NonAxisLower(from),
+    Param::NonAxisLower(to),
+    faceAxis - fromAxis,
+    toAxis - fromAxis,
+    fixedPoint);
+
+  crossAxis = nonLower;
+
+  double nonUpper =
+    nonLower + Param::NonAxisUpper(from, size) - Param::NonAxisLower(from);
+
+  // A ray has no extent, so it can't overlap the inside of a face. It hits a
+  // face if it lies within the face's half-open range instead, so that a ray
+  // along the seam between two tiles hits one of them, whether or not their
+  // faces have been merged.
+  if (nonUpper == nonLower)
+  {
+    return (nonLower >= lower) && (nonLower < upper);
+  }
+
+  return (nonUpper > lower) && (nonLower < upper);
+}
+
+bool PonderingSystem::findFirstImpact(
+  id_type entity,
+  vec2d newPos,
+  bool& horizontal,
+  double& time,
+  double& crossAxis)
+{
+  auto& transform = game_.getEntityManager().
+    getComponent<TransformableComponent>(entity);
+
+  auto& ponderable = game_.getEntityManager().
+    getComponent<PonderableComponent>(entity);
+
+  // Find the bodies that the body could touch along the way. The candidate
+  // buffer is free here, because bodies with passengers don't get this far.
+  candidates_.clear();
+
+  grid_.query(
+    vec2d(
+      std::min(transform.pos.x(), newPos.x()),
+      std::min(transform.pos.y(), newPos.y())),
+    vec2d(
+      std::max(transform.pos.x(), newPos.x()) + transform.size.w(),
+      std::max(transform.pos.y(), newPos.y()) + transform.size.h()),
+    candidates_);
+
+  candidates_.erase(
+    std::remove_if(
+      std::begin(candidates_),
+      std::end(candidates_),
+      [&] (id_type collider) {
+        if (collider == entity)
+        {
+          return true;
+        }
+
+        auto& colliderPonder = game_.getEntityManager().
+          getComponent<PonderableComponent>(collider);
+
+        return (!colliderPonder.active ||
+          !colliderPonder.collidable ||
+          !ponderable.canCollideWith(colliderPonder));
+      }),
+    std::end(candidates_));
+
+  Impact impact;
+
+  if (!findSweepImpact(
+    transform.pos,
+    transform.size,
+    newPos,
+    candidates_,
+    impact))
+  {
+    return false;
+  }
+
+  horizontal =
+    (impact.dir == Direction::left) || (impact.dir == Direction::right);
+
+  time = impact.time;
+  crossAxis = impact.crossAxis;
+
+  return true;
+}
+
+bool PonderingSystem::findSweepImpact(
+  const vec2d& pos,
+  const vec2i& size,
+  const vec2d& newPos,
+  const std::vector<id_type>& colliders,
+  Impact& impact) const
+{
+  id_type mapEntity =
+    game_.getSystemManager().getSystem<RealizingSystem>().getActiveMap();
+
+  auto& mappable = game_.getEntityManager().
+    getComponent<MappableComponent>(mapEntity);
+
+  Impact horizImpact;
+  bool horizFound = false;
+
+  if (newPos.x() < pos.x())
+  {
+    horizFound = findImpactInDirection<CollisionParams::Left>(
+      mapEntity, mappable, pos, size, newPos, colliders, horizImpact);
+  } else if (newPos.x() > pos.x())
+  {
+    horizFound = findImpactInDirection<CollisionParams::Right>(
+      mapEntity, mappable, pos, size, newPos, colliders, horizImpact);
+  }
+
+  Impact vertImpact;
+  bool vertFound = false;
+
+  if (newPos.y() < pos.y())
+  {
+    vertFound = findImpactInDirection<CollisionParams::Up>(
+      mapEntity, mappable, pos, size, newPos, colliders, vertImpact);
+  } else if (newPos.y() > pos.y())
+  {
+    vertFound = findImpactInDirection<CollisionParams::Down>(
+      mapEntity, mappable, pos, size, newPos, colliders, vertImpact);
+  }
+
+  // Ties go to the horizontal axis, which used to always be swept first. This
+  // keeps a body that is walking along the floor into a wall from being
+  // pushed along the wall before the floor is found.
+  if (horizFound && (!vertFound || (horizImpact.time <= vertImpact.time)))
+  {
+    impact = horizImpact;
+
+    return true;
+  } else if (vertFound)
+  {
+    impact = vertImpact;
+
+    return true;
+  }
+
+  return false;
+}
+
+template <typename Param>
+bool PonderingSystem::findImpactInDirection(
+  id_type mapEntity,
+  const MappableComponent& mappable,
+  const vec2d& pos,
+  const vec2i& size,
+  const vec2d& newPos,
+  const std::vector<id_type>& colliders,
+  Impact& impact) const
+{
+  bool fixedPoint = (arithmetic_ == Arithmetic::fixed);
+  bool found = false;
+  double faceTime;
+  double faceCross;
+
+  auto consider = [&] (
+    double faceAxis,
+    double lower,
+    double upper,
+    id_type collider,
+    PonderableComponent::Collision type) {
+    bool touched = findFaceImpact<Param>(
+      pos,
+      newPos,
+      size,
+      faceAxis,
+      lower,
+      upper,
+      fixedPoint,
+      faceTime,
+      faceCross);
+
+    if (touched && (!found || (faceTime < impact.time)))
+    {
+      impact.time = faceTime;
+      impact.crossAxis = faceCross;
+      impact.dir = Param::Dir;
+      impact.collider = collider;
+      impact.type = type;
+      found = true;
+    }
+
+    return touched;
+  };
+
+  for (id_type collider : colliders)
+  {
+    auto& colliderTrans = game_.getEntityManager().
+      getComponent<TransformableComponent>(collider);
+
+    auto& colliderPonder = game_.getEntityManager().
+      getComponent<PonderableComponent>(collider);
+
+    consider(
+      Param::ObjectAxis(colliderTrans),
+      Param::NonAxisLower(colliderTrans.pos),
+      Param::NonAxisUpper(colliderTrans.pos, colliderTrans.size),
+      collider,
+      colliderPonder.colliderType);
+  }
+
+  double fromAxis = Param::EntityAxis(pos, size);
+  double toAxis = Param::EntityAxis(newPos, size);
+
+  if (environmentBackend_ == EnvironmentBackend::tiles)
+  {
+    const TileCollisionGrid& grid = mappable.collisionGrid;
+
+    double sweepLower = std::min(fromAxis, toAxis);
+    double sweepUpper = std::max(fromAxis, toAxis);
+    double extent = Param::NonAxisUpper(pos, size) - Param::NonAxisLower(pos);
+
+    // Step through the columns of tiles along the axis of movement in the
+    // order that the body crosses them, as in Amanatides and Woo's traversal,
+    // but for a box rather than a ray. A tile of slack on either end covers
+    // faces that are not on a tile edge.
+    int fromTile = clampTile(
+      static_cast<int>(std::floor(fromAxis / Param::AxisTileSize)) -
+        Param::Step,
+      Param::AxisTiles);
+
+    int toTile = clampTile(
+      static_cast<int>(std::floor(toAxis / Param::AxisTileSize)) +
+        Param::Step,
+      Param::AxisTiles);
+
+    for (int tile = fromTile;
+      (tile - toTile) * Param::Step <= 0;
+      tile += Param::Step)
+    {
+      // The faces of a tile lie within the tile, so only the part of the
+      // sweep that is within this column can touch them.
+      double columnLower = std::max(
+        sweepLower,
+        static_cast<double>(tile * Param::AxisTileSize));
+
+      double columnUpper = std::min(
+        sweepUpper,
+        static_cast<double>((tile + 1) * Param::AxisTileSize));
+
+      if (columnLower > columnUpper)
+      {
+        continue;
+      }
+
+      // The rows that the body overlaps while it is within the column. The
+      // body's position is found the same way that findFaceImpact finds it,
+      // so that no row it could touch a face in is left out.
+      double enterLower = interpolate(
+        Param::NonAxisLower(pos),
+        Param::NonAxisLower(newPos),
+        columnLower - fromAxis,
+        toAxis - fromAxis,
+        fixedPoint);
+
+      double exitLower = interpolate(
+        Param::NonAxisLower(pos),
+        Param::NonAxisLower(newPos),
+        columnUpper - fromAxis,
+        toAxis - fromAxis,
+        fixedPoint);
+
+      int firstRow = clampTile(
+        static_cast<int>(std::floor(
+          std::min(enterLower, exitLower) / Param::NonAxisTileSize)),
+        Param::NonAxisTiles);
+
+      // A ray on the seam between two rows belongs to the later one.
+      int lastRow;
+
+      if (extent > 0.0)
+      {
+        lastRow = static_cast<int>(std::ceil(
+          (std::max(enterLower, exitLower) + extent) /
+            Param::NonAxisTileSize)) - 1;
+      } else {
+        lastRow = static_cast<int>(std::floor(
+          std::max(enterLower, exitLower) / Param::NonAxisTileSize));
+      }
+
+      lastRow = clampTile(lastRow, Param::NonAxisTiles);
+
+      bool touched = false;
+
+      for (int row = firstRow; row <= lastRow; row++)
+      {
+        vec2i coords = Param::TileCoords(tile, row);
+
+        if (!grid.hasFace(Param::Dir, coords.x(), coords.y()))
+        {
+          continue;
+        }
 
-PonderingSystem::CollisionResult PonderingSystem::detectCollisions(
-  id_type entity,
-  vec2d newPos)
-{
-  auto& transformable = game_.getEntityManager().
-    getComponent<TransformableComponent>(entity);
+        PonderableComponent::Collision type =
+          grid.getFace(Param::Dir, coords.x(), coords.y());
 
-  CollisionResult result;
-  result.pos.x() = newPos.x();
-  result.pos.y() = transformable.pos.y();
+        double lower;
+        double upper;
+        TileCollisionGrid::getFaceRange(
+          Param::Dir,
+          coords.x(),
+          coords.y(),
+          lower,
+          upper);
+
+        if (consider(
+          TileCollisionGrid::getFaceAxis(
+            Param::Dir,
+            coords.x(),
+            coords.y(),
+            type),
+          lower,
+          upper,
+          mapEntity,
+          type))
+        {
+          touched = true;
+        }
+      }
 
-  // Find horizontal collisions.
-  if (result.pos.x() < transformable.pos.x())
-  {
-    detectCollisionsInDirection<CollisionParams::Left>(entity, result);
-  } else if (result.pos.x() > transformable.pos.x())
-  {
-    detectCollisionsInDirection<CollisionParams::Right>(entity, result);
-  }
+      // The faces in later columns are all further along the axis, so they
+      // can only be touched later.
+      if (touched)
+      {
+        break;
+      }
+    }
 
-  // Find vertical collisions
-  if (!result.stopProcessing)
-  {
-    result.pos.y() = newPos.y();
-    result.touchedWall = false;
+    const TileCollisionGrid::Edge& edge = grid.getEdge(Param::Dir);
 
-    if (result.pos.y() < transformable.pos.y())
+    if (edge.present)
     {
-      detectCollisionsInDirection<CollisionParams::Up>(entity, result);
-    } else if (result.pos.y() > transformable.pos.y())
+      consider(edge.axis, edge.lower, edge.upper, mapEntity, edge.type);
+    }
+  } else {
+    auto& boundaries = Param::MapBoundaries(mappable);
+
+    // Boundaries are ordered along the axis of movement, so nothing past the
+    // first one that the body touches can be touched any sooner.
+    for (size_t it = boundaries.lowerBound(fromAxis);
+      it < boundaries.upperBound(toAxis);
+      it++)
     {
-      detectCollisionsInDirection<CollisionParams::Down>(entity, result);
+      if (consider(
+          boundaries.getAxis(it),
+          boundaries.getLower(it),
+          boundaries.getUpper(it),
+          mapEntity,
+          boundaries.getType(it)))
+      {
+        break;
+      }
     }
   }
 
-  return result;
+  return found;
 }
 
 template <typename Param>
@@ -536,34 +1618,20 @@ void PonderingSystem::detectCollisionsInDirection(
   auto& ponderable = game_.getEntityManager().
     getComponent<PonderableComponent>(entity);
 
-  bool boundaryCollision = false;
-
-  auto boundaries = Param::MapBoundaries(mappable);
-  auto it = boundaries.lower_bound(Param::EntityAxis(transform));
-
-  // Find the axis distance of the closest environmental boundary.
-  for (;
-      (it != std::end(boundaries)) &&
-        Param::AtLeastInAxisSweep(
-          it->first,
-          Param::EntityAxis(result.pos, transform.size));
-      it++)
-  {
-    // Check that the boundary is in range for the other axis.
-    if ((Param::NonAxisUpper(result.pos, transform.size) > it->second.lower) &&
-        (Param::NonAxisLower(result.pos) < it->second.upper))
-    {
-      // We have a collision!
-      boundaryCollision = true;
-
-      break;
-    }
-  }
+  // Find the closest environmental boundary that the entity would cross.
+  double boundaryAxis;
+  bool boundaryCollision = findEnvironmentCollision<Param>(
+    mappable,
+    transform,
+    result,
+    boundaryAxis);
 
   // Find the results of pretending to move the entity's passengers, if there
-  // are any.
+  // are any. Finding them may in turn pretend to move the passengers'
+  // passengers, so each call only uses the part of the buffer past its base,
+  // and truncates it back when it returns.
   vec2d delta = result.pos - transform.pos;
-  std::map<id_type, CollisionResult> passResults;
+  size_t passBase = passengerMoves_.size();
 
   for (id_type passenger : ponderable.passengers)
   {
@@ -575,20 +1643,59 @@ void PonderingSystem::detectCollisionsInDirection(
       auto& passTrans = game_.getEntityManager().
         getComponent<TransformableComponent>(passenger);
 
-      passResults[passenger] =
-        detectCollisions(passenger, passTrans.pos + delta);
+      vec2d passPos = detectCollisions(passenger, passTrans.pos + delta).pos;
+
+      passengerMoves_.emplace_back(passenger, passPos);
     }
   }
 
+  size_t passEnd = passengerMoves_.size();
+
+  // If a body is one of the passengers that were pretended to have moved,
+  // replaces its position with where it would have moved to.
+  auto findPassengerMove = [&] (id_type body, vec2d& pos) {
+    for (size_t i = passBase; i < passEnd; i++)
+    {
+      if (passengerMoves_[i].first == body)
+      {
+        pos = passengerMoves_[i].second;
+
+        return;
+      }
+    }
+  };
+
+  // Find the bodies near the path that the entity sweeps out. Passengers are
+  // included regardless, since they are treated as having already moved.
+  // Nothing below pretends to move bodies, so these buffers aren't shared with
+  // nested calls.
+  std::vector<id_type>& candidates = candidates_;
+  candidates.assign(
+    std::begin(ponderable.passengers),
+    std::end(ponderable.passengers));
+
+  grid_.query(
+    vec2d(
+      std::min(transform.pos.x(), result.pos.x()),
+      std::min(transform.pos.y(), result.pos.y())),
+    vec2d(
+      std::max(transform.pos.x(), result.pos.x()) + transform.size.w(),
+      std::max(transform.pos.y(), result.pos.y()) + transform.size.h()),
+    candidates);
+
+  // Visit candidates in ID order, so that ties between equally close colliders
+  // are broken the same way no matter how the grid is laid out.
+  std::sort(std::begin(candidates), std::end(candidates));
+  candidates.erase(
+    std::unique(std::begin(candidates), std::end(candidates)),
+    std::end(candidates));
+
   // Find a list of potential colliders, sorted so that the closest is
   // first.
-  std::vector<id_type> colliders;
-
-  auto entities = game_.getEntityManager().getEntitiesWithComponents<
-    PonderableComponent,
-    TransformableComponent>();
+  std::vector<id_type>& colliders = colliders_;
+  colliders.clear();
 
-  for (id_type collider : entities)
+  for (id_type collider : candidates)
   {
     // Can't collide with self.
     if (collider == entity)
@@ -599,24 +1706,24 @@ void PonderingSystem::detectCollisionsInDirection(
     auto& colliderPonder = game_.getEntityManager().
       getComponent<PonderableComponent>(collider);
 
-    // Only check objects that are active and collidable.
-    if (!colliderPonder.active || !colliderPonder.collidable)
+    // Only check objects that are active and collidable, and that are on a
+    // layer that the entity collides with.
+    if (!colliderPonder.active ||
+      !colliderPonder.collidable ||
+      !ponderable.canCollideWith(colliderPonder))
     {
       continue;
     }
 
-    // If the collider is a passenger of the entity, pretend that it has already
-    // moved.
     auto& colliderTrans = game_.getEntityManager().
       getComponent<TransformableComponent>(collider);
 
+    // If the collider is a passenger of the entity, pretend that it has
+    // already moved.
     vec2d colliderPos = colliderTrans.pos;
     vec2i colliderSize = colliderTrans.size;
 
-    if (passResults.count(collider))
-    {
-      colliderPos = passResults[collider].pos;
-    }
+    findPassengerMove(collider, colliderPos);
 
     // Check if the entity would move into the potential collider,
     if (Param::IsPastAxis(
@@ -636,7 +1743,7 @@ void PonderingSystem::detectCollisionsInDirection(
         (!boundaryCollision ||
           Param::AtLeastInAxisSweep(
             Param::ObjectAxis(colliderPos, colliderSize),
-            it->first)))
+            boundaryAxis)))
     {
       colliders.push_back(collider);
     }
@@ -654,20 +1761,14 @@ void PonderingSystem::detectCollisionsInDirection(
 
       vec2d leftPos = leftTrans.pos;
 
-      if (passResults.count(left))
-      {
-        leftPos = passResults[left].pos;
-      }
+      findPassengerMove(left, leftPos);
 
       auto& rightTrans = game_.getEntityManager().
         getComponent<TransformableComponent>(right);
 
       vec2d rightPos = rightTrans.pos;
 
-      if (passResults.count(right))
-      {
-        rightPos = passResults[right].pos;
-      }
+      findPassengerMove(right, rightPos);
 
       return Param::Closer(
         Param::ObjectAxis(leftPos, leftTrans.size),
@@ -684,10 +1785,7 @@ void PonderingSystem::detectCollisionsInDirection(
     vec2d colliderPos = colliderTrans.pos;
     vec2i colliderSize = colliderTrans.size;
 
-    if (passResults.count(collider))
-    {
-      colliderPos = passResults[collider].pos;
-    }
+    findPassengerMove(collider, colliderPos);
 
     // Check if the entity would still move into the potential collider.
     if (!Param::IsPastAxis(
@@ -722,24 +1820,234 @@ void PonderingSystem::detectCollisionsInDirection(
   // boundaries closest to the entity.
   if (!result.stopProcessing && !result.touchedWall && boundaryCollision)
   {
-    double boundaryAxis = it->first;
+    processEnvironmentCollisions<Param>(
+      entity,
+      mapEntity,
+      mappable,
+      boundaryAxis,
+      result);
+  }
+
+  passengerMoves_.resize(passBase);
+}
+
+template <typename Param>
+bool PonderingSystem::findEnvironmentCollision(
+  const MappableComponent& mappable,
+  const TransformableComponent& transform,
+  const CollisionResult& result,
+  double& axis) const
+{
+  if (environmentBackend_ == EnvironmentBackend::tiles)
+  {
+    return findTileCollision<Param>(mappable, transform, result, axis);
+  }
+
+  auto& boundaries = Param::MapBoundaries(mappable);
+
+  // Find the closest boundary within the sweep that is in range for the other
+  // axis.
+  size_t boundaryEnd = boundaries.upperBound(
+    Param::EntityAxis(result.pos, transform.size));
+
+  size_t it = boundaries.findOverlap(
+    boundaries.lowerBound(Param::EntityAxis(transform)),
+    boundaryEnd,
+    Param::NonAxisLower(result.pos),
+    Param::NonAxisUpper(result.pos, transform.size));
+
+  if (it == boundaryEnd)
+  {
+    return false;
+  }
+
+  axis = boundaries.getAxis(it);
+
+  return true;
+}
+
+template <typename Param>
+bool PonderingSystem::findTileCollision(
+  const MappableComponent& mappable,
+  const TransformableComponent& transform,
+  const CollisionResult& result,
+  double& axis) const
+{
+  const TileCollisionGrid& grid = mappable.collisionGrid;
+
+  double oldAxis = Param::EntityAxis(transform);
+  double newAxis = Param::EntityAxis(result.pos, transform.size);
+  double nonLower = Param::NonAxisLower(result.pos);
+  double nonUpper = Param::NonAxisUpper(result.pos, transform.size);
+
+  auto inSweep = [&] (double faceAxis, double lower, double upper) {
+    return !Param::Closer(faceAxis, oldAxis) &&
+      Param::AtLeastInAxisSweep(faceAxis, newAxis) &&
+      (nonUpper > lower) &&
+      (nonLower < upper);
+  };
+
+  // The rows of tiles that the entity overlaps on the other axis.
+  int firstRow = clampTile(
+    static_cast<int>(std::floor(nonLower / Param::NonAxisTileSize)),
+    Param::NonAxisTiles);
+
+  int lastRow = clampTile(
+    static_cast<int>(std::ceil(nonUpper / Param::NonAxisTileSize)) - 1,
+    Param::NonAxisTiles);
+
+  // Step through the tiles along the axis of movement in the order that the
+  // entity crosses them. A tile of slack on either end covers faces that are
+  // not on a tile edge.
+  int fromTile = clampTile(
+    static_cast<int>(std::floor(oldAxis / Param::AxisTileSize)) - Param::Step,
+    Param::AxisTiles);
+
+  int toTile = clampTile(
+    static_cast<int>(std::floor(newAxis / Param::AxisTileSize)) + Param::Step,
+    Param::AxisTiles);
+
+  for (int tile = fromTile;
+    (tile - toTile) * Param::Step <= 0;
+    tile += Param::Step)
+  {
+    bool found = false;
+
+    for (int row = firstRow; row <= lastRow; row++)
+    {
+      vec2i coords = Param::TileCoords(tile, row);
+
+      if (!grid.hasFace(Param::Dir, coords.x(), coords.y()))
+      {
+        continue;
+      }
+
+      double faceAxis = TileCollisionGrid::getFaceAxis(
+        Param::Dir,
+        coords.x(),
+        coords.y(),
+        grid.getFace(Param::Dir, coords.x(), coords.y()));
+
+      double lower;
+      double upper;
+      TileCollisionGrid::getFaceRange(
+        Param::Dir,
+        coords.x(),
+        coords.y(),
+        lower,
+        upper);
+
+      if (inSweep(faceAxis, lower, upper) &&
+        (!found || Param::Closer(faceAxis, axis)))
+      {
+        axis = faceAxis;
+        found = true;
+      }
+    }
+
+    if (found)
+    {
+      return true;
+    }
+  }
+
+  // The edge of the map is beyond every tile.
+  const TileCollisionGrid::Edge& edge = grid.getEdge(Param::Dir);
+
+  if (edge.present && inSweep(edge.axis, edge.lower, edge.upper))
+  {
+    axis = edge.axis;
+
+    return true;
+  }
+
+  return false;
+}
+
+template <typename Param>
+void PonderingSystem::processEnvironmentCollisions(
+  id_type entity,
+  id_type mapEntity,
+  const MappableComponent& mappable,
+  double axis,
+  CollisionResult& result)
+{
+  auto& transform = game_.getEntityManager().
+    getComponent<TransformableComponent>(entity);
+
+  double nonLower = Param::NonAxisLower(result.pos);
+  double nonUpper = Param::NonAxisUpper(result.pos, transform.size);
+
+  if (environmentBackend_ == EnvironmentBackend::tiles)
+  {
+    const TileCollisionGrid& grid = mappable.collisionGrid;
+    const TileCollisionGrid::Edge& edge = grid.getEdge(Param::Dir);
+
+    if (edge.present && (edge.axis == axis))
+    {
+      if ((nonLower < edge.upper) && (nonUpper > edge.lower))
+      {
+        processCollision(
+          entity,
+          mapEntity,
+          Param::Dir,
+          edge.type,
+          edge.axis,
+          edge.lower,
+          edge.upper,
+          result);
+      }
 
-    for (;
-        (it != std::end(boundaries)) &&
-          (it->first == boundaryAxis);
-        it++)
+      return;
+    }
+
+    int tile = Param::FaceTile(axis, Param::AxisTileSize);
+
+    int firstRow = clampTile(
+      static_cast<int>(std::floor(nonLower / Param::NonAxisTileSize)),
+      Param::NonAxisTiles);
+
+    int lastRow = clampTile(
+      static_cast<int>(std::ceil(nonUpper / Param::NonAxisTileSize)) - 1,
+      Param::NonAxisTiles);
+
+    for (int row = firstRow; row <= lastRow; row++)
     {
-      if ((Param::NonAxisLower(result.pos) < it->second.upper) &&
-          (Param::NonAxisUpper(result.pos, transform.size) > it->second.lower))
+      vec2i coords = Param::TileCoords(tile, row);
+
+      if (!grid.hasFace(Param::Dir, coords.x(), coords.y()))
+      {
+        continue;
+      }
+
+      PonderableComponent::Collision type =
+        grid.getFace(Param::Dir, coords.x(), coords.y());
+
+      double lower;
+      double upper;
+      TileCollisionGrid::getFaceRange(
+        Param::Dir,
+        coords.x(),
+        coords.y(),
+        lower,
+        upper);
+
+      if ((TileCollisionGrid::getFaceAxis(
+            Param::Dir,
+            coords.x(),
+            coords.y(),
+            type) == axis) &&
+          (nonLower < upper) &&
+          (nonUpper > lower))
       {
         processCollision(
           entity,
           mapEntity,
           Param::Dir,
-          it->second.type,
-          it->first,
-          it->second.lower,
-          it->second.upper,
+          type,
+          axis,
+          lower,
+          upper,
           result);
 
         if (result.stopProcessing)
@@ -748,6 +2056,35 @@ void PonderingSystem::detectCollisionsInDirection(
         }
       }
     }
+
+    return;
+  }
+
+  auto& boundaries = Param::MapBoundaries(mappable);
+
+  for (size_t it = boundaries.lowerBound(axis);
+      (it < boundaries.size()) &&
+        (boundaries.getAxis(it) == axis);
+      it++)
+  {
+    if ((nonLower < boundaries.getUpper(it)) &&
+        (nonUpper > boundaries.getLower(it)))
+    {
+      processCollision(
+        entity,
+        mapEntity,
+        Param::Dir,
+        boundaries.getType(it),
+        boundaries.getAxis(it),
+        boundaries.getLower(it),
+        boundaries.getUpper(it),
+        result);
+
+      if (result.stopProcessing)
+      {
+        break;
+      }
+    }
   }
 }
 
@@ -880,14 +2217,30 @@ void PonderingSystem::processCollision(
 
     case PonderableComponent::Collision::danger:
     {
+      contact_type contact(entity, collider, type);
+
       if (game_.getEntityManager().
         hasComponent<PlayableComponent>(entity))
       {
-        game_.getSystemManager().getSystem<PlayingSystem>().die(entity);
-
         result.adjacentlyWarping = false;
+
+        // The player dies once every body has moved, but it has to stop where
+        // it is now, as if it had died already, rather than carrying on into
+        // the hazard. Dying freezes the body in the same way.
+        if (!std::binary_search(
+          std::begin(previousContacts_),
+          std::end(previousContacts_),
+          contact))
+        {
+          auto& ponderable = game_.getEntityManager().
+            getComponent<PonderableComponent>(entity);
+
+          ponderable.frozen = true;
+          ponderable.collidable = false;
+        }
       }
 
+      contacts_.push_back(contact);
       result.stopProcessing = true;
 
       break;
@@ -895,12 +2248,7 @@ void PonderingSystem::processCollision(
 
     case PonderableComponent::Collision::event:
     {
-      if (game_.getEntityManager().
-        hasComponent<PlayableComponent>(entity))
-      {
-        game_.getSystemManager().getSystem<ScriptingSystem>().
-          onTouch(collider, entity);
-      }
+      contacts_.emplace_back(entity, collider, type);
 
       break;
     }
@@ -953,3 +2301,228 @@ void PonderingSystem::processCollision(
     }
   }
 }
+
+PonderingSystem::QueryHit PonderingSystem::raycast(
+  vec2d from,
+  vec2d to,
+  PonderableComponent::layer_type mask)
+{
+  return sweep(from, vec2i(0, 0), to, mask);
+}
+
+PonderingSystem::QueryHit PonderingSystem::sweep(
+  vec2d pos,
+  vec2i size,
+  vec2d to,
+  PonderableComponent::layer_type mask)
+{
+  queryColliders_.clear();
+
+  grid_.query(
+    vec2d(std::min(pos.x(), to.x()), std::min(pos.y(), to.y())),
+    vec2d(
+      std::max(pos.x(), to.x()) + size.w(),
+      std::max(pos.y(), to.y()) + size.h()),
+    queryColliders_);
+
+  queryColliders_.erase(
+    std::remove_if(
+      std::begin(queryColliders_),
+      std::end(queryColliders_),
+      [&] (id_type collider) {
+        auto& colliderPonder = game_.getEntityManager().
+          getComponent<PonderableComponent>(collider);
+
+        return (!colliderPonder.active ||
+          !colliderPonder.collidable ||
+          ((colliderPonder.layer & mask) == 0));
+      }),
+    std::end(queryColliders_));
+
+  QueryHit hit;
+  Impact impact;
+
+  if (findSweepImpact(pos, size, to, queryColliders_, impact))
+  {
+    hit.hit = true;
+    hit.time = impact.time;
+    hit.pos = pos + (to - pos) * impact.time;
+    hit.dir = impact.dir;
+    hit.collider = impact.collider;
+    hit.type = impact.type;
+  } else {
+    hit.pos = to;
+  }
+
+  return hit;
+}
+
+/**
+ * Returns whether one of the edges of the map passes through the inside of a
+ * box.
+ */
+inline bool crossesMapEdge(
+  const TileCollisionGrid& grid,
+  Direction dir,
+  const vec2d& lower,
+  const vec2d& upper)
+{
+  const TileCollisionGrid::Edge& edge = grid.getEdge(dir);
+
+  if (!edge.present)
+  {
+    return false;
+  }
+
+  if ((dir == Direction::left) || (dir == Direction::right))
+  {
+    return (lower.x() < edge.axis) && (edge.axis < upper.x()) &&
+      (lower.y() < edge.upper) && (edge.lower < upper.y());
+  } else {
+    return (lower.y() < edge.axis) && (edge.axis < upper.y()) &&
+      (lower.x() < edge.upper) && (edge.lower < upper.x());
+  }
+}
+
+/**
+ * Returns whether a box overlaps the inside of a solid tile. The interior
+ * faces of a block of walls are not stored, so this looks at the tiles
+ * themselves rather than at the boundaries.
+ */
+inline bool overlapsSolidTile(
+  const TileCollisionGrid& grid,
+  const vec2d& lower,
+  const vec2d& upper)
+{
+  int firstCol = clampTile(
+    static_cast<int>(std::floor(lower.x() / TILE_WIDTH)),
+    MAP_WIDTH);
+
+  int lastCol = clampTile(
+    static_cast<int>(std::ceil(upper.x() / TILE_WIDTH)) - 1,
+    MAP_WIDTH);
+
+  int firstRow = clampTile(
+    static_cast<int>(std::floor(lower.y() / TILE_HEIGHT)),
+    MAP_HEIGHT);
+
+  int lastRow = clampTile(
+    static_cast<int>(std::ceil(upper.y() / TILE_HEIGHT)) - 1,
+    MAP_HEIGHT);
+
+  for (int y = firstRow; y <= lastRow; y++)
+  {
+    for (int x = firstCol; x <= lastCol; x++)
+    {
+      if (!grid.isSolid(x, y))
+      {
+        continue;
+      }
+
+      // The top of a solid tile is where its top face would be, which is
+      // lower than the top of the tile for danger tiles.
+      double top = TileCollisionGrid::getFaceAxis(
+        Direction::down,
+        x,
+        y,
+        grid.getSolid(x, y));
+
+      if ((x * TILE_WIDTH < upper.x()) &&
+        ((x + 1) * TILE_WIDTH > lower.x()) &&
+        (top < upper.y()) &&
+        ((y + 1) * TILE_HEIGHT > lower.y()))
+      {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+void PonderingSystem::overlap(
+  vec2d pos,
+  vec2i size,
+  std::vector<id_type>& out,
+  PonderableComponent::layer_type mask)
+{
+  vec2d upper = pos + vec2d(size);
+
+  queryColliders_.clear();
+  grid_.query(pos, upper, queryColliders_);
+  triggers_.query(pos, upper, queryColliders_);
+
+  std::sort(std::begin(queryColliders_), std::end(queryColliders_));
+  queryColliders_.erase(
+    std::unique(std::begin(queryColliders_), std::end(queryColliders_)),
+    std::end(queryColliders_));
+
+  for (id_type collider : queryColliders_)
+  {
+    auto& colliderPonder = game_.getEntityManager().
+      getComponent<PonderableComponent>(collider);
+
+    if (!colliderPonder.active ||
+      !colliderPonder.collidable ||
+      ((colliderPonder.layer & mask) == 0))
+    {
+      continue;
+    }
+
+    auto& colliderTrans = game_.getEntityManager().
+      getComponent<TransformableComponent>(collider);
+
+    if ((colliderTrans.pos.x() < upper.x()) &&
+      (colliderTrans.pos.x() + colliderTrans.size.w() > pos.x()) &&
+      (colliderTrans.pos.y() < upper.y()) &&
+      (colliderTrans.pos.y() + colliderTrans.size.h() > pos.y()))
+    {
+      out.push_back(collider);
+    }
+  }
+
+  id_type mapEntity =
+    game_.getSystemManager().getSystem<RealizingSystem>().getActiveMap();
+
+  auto& mappable = game_.getEntityManager().
+    getComponent<MappableComponent>(mapEntity);
+
+  const TileCollisionGrid& grid = mappable.collisionGrid;
+
+  if (overlapsSolidTile(grid, pos, upper) ||
+    crossesMapEdge(grid, Direction::left, pos, upper) ||
+    crossesMapEdge(grid, Direction::right, pos, upper) ||
+    crossesMapEdge(grid, Direction::up, pos, upper) ||
+    crossesMapEdge(grid, Direction::down, pos, upper))
+  {
+    out.push_back(mapEntity);
+  }
+}
+
+void PonderingSystem::raycastBatch(
+  const std::vector<Ray>& rays,
+  std::vector<QueryHit>& hits,
+  PonderableComponent::layer_type mask)
+{
+  hits.clear();
+  hits.reserve(rays.size());
+
+  for (const Ray& ray : rays)
+  {
+    hits.push_back(raycast(ray.from, ray.to, mask));
+  }
+}
+
+void PonderingSystem::sweepBatch(
+  const std::vector<Sweep>& sweeps,
+  std::vector<QueryHit>& hits,
+  PonderableComponent::layer_type mask)
+{
+  hits.clear();
+  hits.reserve(sweeps.size());
+
+  for (const Sweep& query : sweeps)
+  {
+    hits.push_back(sweep(query.pos, query.size, query.to, mask));
+  }
+}
@@ -1,20 +1,109 @@
 #ifndef PONDERING_H_F2530E0E
 #define PONDERING_H_F2530E0E
 
+#include <vector>
+#include <string>
+#include <tuple>
+#include <utility>
 #include "system.h"
 #include "components/ponderable.h"
 #include "direction.h"
 #include "vector.h"
+#include "spatial_grid.h"
+#include "body_store.h"
+#include "profiler.h"
+
+class MappableComponent;
+class TransformableComponent;
 
 class PonderingSystem : public System {
 public:
 
+  /**
+   * The ways in which collisions with the environment can be detected.
+   *
+   * boundaries - Search the map's sorted boundary lists. This is the default.
+   * tiles      - Step through the tiles that the body sweeps across.
+   *
+   * Both produce the same collisions.
+   */
+  enum class EnvironmentBackend {
+    boundaries,
+    tiles
+  };
+
+  /**
+   * The arithmetic that bodies are moved with.
+   *
+   * floating - Double precision throughout. This is the default.
+   * fixed    - Positions and velocities are kept on a 16.16 fixed-point grid,
+   *            and everything that could round differently depending on how
+   *            the game was compiled is done with integers instead. Runs are
+   *            then bit-identical across builds.
+   */
+  enum class Arithmetic {
+    floating,
+    fixed
+  };
+
+  /**
+   * A change in contact between a body and a collider whose effect goes
+   * beyond blocking movement, such as an event trigger or a hazard. The
+   * collider is the map entity for contacts with the map itself.
+   *
+   * begin   - The body touched the collider this tick, but not last tick.
+   * persist - The body touched the collider both this tick and last tick.
+   * end     - The body touched the collider last tick, but not this tick.
+   */
+  struct ContactEvent {
+    enum class Phase {
+      begin,
+      persist,
+      end
+    };
+
+    Phase phase;
+    id_type entity;
+    id_type collider;
+    PonderableComponent::Collision type;
+  };
+
+  /**
+   * The first surface that a raycast or sweep reaches. The time is a fraction
+   * of the way along the query, and the position is where the ray or box is
+   * at that moment, or its destination if it doesn't hit anything. The
+   * direction is the one in which the query crossed the surface. The collider
+   * is the map entity for the map's own walls, and EntityHandle::none on a
+   * miss.
+   */
+  struct QueryHit {
+    bool hit = false;
+    double time = 1.0;
+    vec2d pos;
+    Direction dir = Direction::left;
+    id_type collider = EntityHandle::none;
+    PonderableComponent::Collision type = PonderableComponent::Collision::wall;
+  };
+
+  struct Ray {
+    vec2d from;
+    vec2d to;
+  };
+
+  struct Sweep {
+    vec2d pos;
+    vec2i size;
+    vec2d to;
+  };
+
   PonderingSystem(Game& game) : System(game)
   {
   }
 
   void tick(double dt);
 
+  Access getAccess() const;
+
   void initializeBody(id_type entity, PonderableComponent::Type type);
 
   /**
@@ -33,6 +122,116 @@ public:
    */
   void unferry(id_type entity);
 
+  /**
+   * Updates the broadphase after a ponderable entity has been moved or resized
+   * outside the PonderingSystem during a tick, so that other bodies can still
+   * collide with it.
+   */
+  void refreshBody(id_type entity);
+
+  /**
+   * Wakes a sleeping body at the start of the next tick. Changes to a body's
+   * position, velocity, acceleration, target velocity, or its frozen or
+   * collidable flags are noticed without this; use it when something else
+   * about a body's surroundings has changed.
+   *
+   * @requires entity is ponderable
+   */
+  void wakeBody(id_type entity);
+
+  /**
+   * Finds the first surface that a ray would cross, out of the active map's
+   * boundaries and the collidable bodies on the given layers. Trigger volumes
+   * are never hit, and neither are bodies that the ray starts inside of.
+   */
+  QueryHit raycast(
+    vec2d from,
+    vec2d to,
+    PonderableComponent::layer_type mask = PonderableComponent::Layer::all);
+
+  /**
+   * Finds the first surface that a box would touch if it moved in a straight
+   * line, as if it were a body. Nothing is moved.
+   */
+  QueryHit sweep(
+    vec2d pos,
+    vec2i size,
+    vec2d to,
+    PonderableComponent::layer_type mask = PonderableComponent::Layer::all);
+
+  /**
+   * Appends the collidable bodies on the given layers that overlap a box,
+   * including trigger volumes, in ID order. The active map is appended last if
+   * the box overlaps one of its wall or hazard tiles, or crosses one of its
+   * edges. Bodies and tiles that are merely touching the box don't count.
+   */
+  void overlap(
+    vec2d pos,
+    vec2i size,
+    std::vector<id_type>& out,
+    PonderableComponent::layer_type mask = PonderableComponent::Layer::all);
+
+  /**
+   * Runs several raycasts, replacing the contents of hits with one result per
+   * ray, in the same order.
+   */
+  void raycastBatch(
+    const std::vector<Ray>& rays,
+    std::vector<QueryHit>& hits,
+    PonderableComponent::layer_type mask = PonderableComponent::Layer::all);
+
+  void sweepBatch(
+    const std::vector<Sweep>& sweeps,
+    std::vector<QueryHit>& hits,
+    PonderableComponent::layer_type mask = PonderableComponent::Layer::all);
+
+  /**
+   * The contact events from the most recent tick, sorted by body and then by
+   * collider. Scripts and deaths are triggered only by begin events.
+   */
+  inline const std::vector<ContactEvent>& getContactEvents() const
+  {
+    return contactEvents_;
+  }
+
+  /**
+   * Times every collision detection pass as a section of the given profiler,
+   * or stops timing if it is null. The profiler must outlive the system, and
+   * this must not be called while systems are ticking.
+   */
+  void setProfiler(Profiler* profiler);
+
+  /**
+   * Converts between environment backends or arithmetic modes and the names
+   * that are used for them on the command line and in input logs.
+   *
+   * @throws std::invalid_argument if the name is not recognized
+   */
+  static EnvironmentBackend parseEnvironmentBackend(const std::string& name);
+  static std::string getEnvironmentBackendName(EnvironmentBackend backend);
+  static Arithmetic parseArithmetic(const std::string& name);
+  static std::string getArithmeticName(Arithmetic arithmetic);
+
+  inline void setEnvironmentBackend(EnvironmentBackend backend)
+  {
+    environmentBackend_ = backend;
+  }
+
+  inline EnvironmentBackend getEnvironmentBackend() const
+  {
+    return environmentBackend_;
+  }
+
+  inline void setArithmetic(Arithmetic arithmetic)
+  {
+    arithmetic_ = arithmetic;
+  }
+
+  inline Arithmetic getArithmetic() const
+  {
+    return arithmetic_;
+  }
+
 private:
 
   struct CollisionResult
@@ -49,23 +248,205 @@ private:
     id_type groundEntity;
   };
 
-  void tickBody(
+  /**
+   * The state of a body at the start of the tick, or when it fell asleep if it
+   * is sleeping. A body is at rest while its state stays the same from tick to
+   * tick.
+   */
+  struct RestState
+  {
+    vec2d pos;
+    vec2d vel;
+    vec2d accel;
+    vec2d targetVel;
+    bool frozen = false;
+    bool collidable = false;
+    int restingTicks = 0;
+    bool woken = false;
+
+    void record(
+      const PonderableComponent& ponderable,
+      const TransformableComponent& transformable);
+
+    bool matches(
+      const PonderableComponent& ponderable,
+      const TransformableComponent& transformable) const;
+  };
+
+  /**
+   * The number of consecutive ticks that a body must be at rest for before it
+   * falls asleep.
+   */
+  static const int TICKS_BEFORE_SLEEP = 30;
+
+  RestState& getRestState(id_type entity);
+
+  /**
+   * Compares the contacts made during the tick with the previous tick's,
+   * queues the resulting contact events, and then acts on them. This runs
+   * after every body has moved, so that collision detection itself has no
+   * side effects outside of the PonderingSystem.
+   */
+  void dispatchContacts();
+
+  /**
+   * Puts a body into whichever broadphase it belongs in: grid_ for bodies that
+   * block or hurt, and triggers_ for trigger volumes.
+   */
+  void updateBroadphase(
+    id_type entity,
+    const PonderableComponent& ponderable,
+    const TransformableComponent& transformable);
+
+  /**
+   * Records a contact for every trigger volume that a body overlaps once every
+   * body has moved. Trigger volumes never block movement, so they are left out
+   * of the sweeps entirely.
+   */
+  void detectTriggerContacts();
+
+  /**
+   * Wakes the sleeping bodies, other than the given entity, that overlap or
+   * touch the given box.
+   */
+  void wakeTouchingBodies(
     id_type entity,
+    const vec2d& lower,
+    const vec2d& upper);
+
+  /**
+   * Ticks a body that isn't ferried, followed by every body that it ferries,
+   * directly or indirectly.
+   */
+  void tickFerryTree(
+    id_type root,
     double dt);
 
+  /**
+   * Moves a body by its velocity, which has already been accelerated for this
+   * tick. Returns whether the body's passengers should be ticked after it.
+   */
+  bool tickBody(
+    id_type entity,
+    double dt);
+
+  /**
+   * Moves a body and then its passengers, and returns the body's collision
+   * result.
+   */
   CollisionResult moveBody(
     id_type entity,
     vec2d newPos);
 
+  /**
+   * Moves a body without moving its passengers or warping it. Returns whether
+   * the body moved, in which case delta is set to how far it went.
+   */
+  bool moveBodyAlone(
+    id_type entity,
+    vec2d newPos,
+    CollisionResult& result,
+    vec2d& delta);
+
+  /**
+   * Warps a body that has moved off the edge of the map to the adjacent map.
+   */
+  void warpBody(
+    id_type entity,
+    const CollisionResult& result);
+
   CollisionResult detectCollisions(
     id_type entity,
     vec2d newPos);
 
+  /**
+   * Finds the first surface that the body would touch if it moved to its new
+   * position in a straight line, rather than one axis at a time. Sets whether
+   * the surface lies across the horizontal axis, when the body would touch it
+   * as a fraction of the move, and where the body would be on the other axis
+   * at that moment. Returns false if the body would not touch anything.
+   */
+  bool findFirstImpact(
+    id_type entity,
+    vec2d newPos,
+    bool& horizontal,
+    double& time,
+    double& crossAxis);
+
+  /**
+   * Where a box moving in a straight line first touches a surface. The time
+   * is a fraction of the move, and the cross axis is where the box is on the
+   * other axis at that moment.
+   */
+  struct Impact
+  {
+    double time;
+    double crossAxis;
+    Direction dir;
+    id_type collider;
+    PonderableComponent::Collision type;
+  };
+
+  /**
+   * Finds the first surface that a box would touch if it moved in a straight
+   * line, out of the active map and the given bodies.
+   */
+  bool findSweepImpact(
+    const vec2d& pos,
+    const vec2i& size,
+    const vec2d& newPos,
+    const std::vector<id_type>& colliders,
+    Impact& impact) const;
+
+  /**
+   * Does the same as findSweepImpact, but only for surfaces facing against
+   * the given direction.
+   */
+  template <typename Param>
+  bool findImpactInDirection(
+    id_type mapEntity,
+    const MappableComponent& mappable,
+    const vec2d& pos,
+    const vec2i& size,
+    const vec2d& newPos,
+    const std::vector<id_type>& colliders,
+    Impact& impact) const;
+
   template <typename Param>
   void detectCollisionsInDirection(
     id_type entity,
     CollisionResult& result);
 
+  /**
+   * Finds the closest environmental boundary that the entity would cross
+   * while moving to its new position, and returns whether there is one.
+   */
+  template <typename Param>
+  bool findEnvironmentCollision(
+    const MappableComponent& mappable,
+    const TransformableComponent& transform,
+    const CollisionResult& result,
+    double& axis) const;
+
+  template <typename Param>
+  bool findTileCollision(
+    const MappableComponent& mappable,
+    const TransformableComponent& transform,
+    const CollisionResult& result,
+    double& axis) const;
+
+  /**
+   * Processes collisions with every environmental boundary at the given axis
+   * that the entity overlaps.
+   */
+  template <typename Param>
+  void processEnvironmentCollisions(
+    id_type entity,
+    id_type mapEntity,
+    const MappableComponent& mappable,
+    double axis,
+    CollisionResult& result);
+
   void processCollision(
     id_type entity,
     id_type collider,
@@ -76,6 +457,92 @@ private:
     double upper,
     CollisionResult& result);
 
+  /**
+   * Broadphase for collisions between bodies. It is rebuilt at the start of
+   * every tick, and updated whenever a body moves.
+   */
+  SpatialGrid grid_;
+
+  /**
+   * Broadphase for trigger volumes, which are bodies whose colliders are
+   * events. It is kept apart from grid_ so that they don't need to be swept.
+   */
+  SpatialGrid triggers_;
+
+  /**
+   * Every layer that a trigger volume has been put on this tick, so that
+   * bodies that can't touch any of them don't need to look for them.
+   */
+  PonderableComponent::layer_type triggerLayers_ =
+    PonderableComponent::Layer::none;
+
+  /**
+   * The motion state of the bodies being accelerated this tick.
+   */
+  BodyStore bodies_;
+
+  /**
+   * A body waiting to be moved by moveBody. The target is relative to the
+   * body's position if the body is a passenger being carried by its ferry.
+   */
+  struct MoveFrame
+  {
+    id_type entity;
+    vec2d target;
+    bool relative;
+    bool expanded = false;
+    bool moved = false;
+    CollisionResult result {};
+  };
+
+  /**
+   * Scratch space that is reused from tick to tick, so that ticking doesn't
+   * need to allocate once the buffers have grown large enough.
+   */
+  std::vector<id_type> tickStack_;
+  std::vector<MoveFrame> moveStack_;
+  std::vector<std::pair<id_type, vec2d>> passengerMoves_;
+  std::vector<id_type> candidates_;
+  std::vector<id_type> colliders_;
+  std::vector<id_type> wakeCandidates_;
+
+  /**
+   * Scratch space for queries, which are kept apart from the buffers above so
+   * that scripts can query at any point in a tick.
+   */
+  std::vector<id_type> queryColliders_;
+
+  /**
+   * Rest tracking for each body, indexed by the body's slot.
+   */
+  std::vector<RestState> restStates_;
+
+  using contact_type =
+    std::tuple<id_type, id_type, PonderableComponent::Collision>;
+
+  /**
+   * The contacts made so far this tick, in the order they were made and
+   * possibly repeated, and those made during the previous tick, sorted and
+   * without repeats. The two are swapped at the end of every tick, so their
+   * storage is reused.
+   */
+  std::vector<contact_type> contacts_;
+  std::vector<contact_type> previousContacts_;
+
+  std::vector<ContactEvent> contactEvents_;
+
+  /**
+   * The number of bodies that were asleep at the start of the tick.
+   */
+  size_t sleepingBodies_ = 0;
+
+  EnvironmentBackend environmentBackend_ = EnvironmentBackend::boundaries;
+
+  Arithmetic arithmetic_ = Arithmetic::floating;
+
+  Profiler* profiler_ = nullptr;
+  Profiler::section_id detectSection_ = 0;
+
 };
 
 #endif /* end of include guard: PONDERING_H_F2530E0E */
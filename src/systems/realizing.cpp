@@ -228,12 +228,20 @@ RealizingSystem::RealizingSystem(
               emplaceComponent<AutomatableComponent>(mapObject);
 
             automatable.table = prototypeId;
+
+            auto& ponderable = game_.getEntityManager().
+              getComponent<PonderableComponent>(mapObject);
+
+            ponderable.layer = PonderableComponent::Layer::platform;
           } else if (prototypeId == "checkpoint")
           {
             auto& ponderable = game_.getEntityManager().
               getComponent<PonderableComponent>(mapObject);
 
+            // Checkpoints are only ever touched by the player.
             ponderable.colliderType = PonderableComponent::Collision::event;
+            ponderable.layer = PonderableComponent::Layer::trigger;
+            ponderable.mask = PonderableComponent::Layer::player;
           }
 
           mappable.objects.push_back(mapObject);
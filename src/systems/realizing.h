@@ -23,6 +23,18 @@ public:
     std::string worldFile,
     std::string prototypeFile);
 
+  /**
+   * This system does not tick, so it never conflicts with other systems.
+   */
+  Access getAccess() const
+  {
+    Access access;
+    access.exclusive = false;
+    access.ticks = false;
+
+    return access;
+  }
+
   id_type getActiveMap() const
   {
     return activeMap_;
@@ -5,28 +5,59 @@
 
 void SchedulingSystem::tick(double dt)
 {
-  auto entities = game_.getEntityManager().getEntitiesWithComponents<
-    SchedulableComponent>();
+  // Actions can make any structural change, such as loading a new map, which
+  // would invalidate the iteration and the component references in it. The
+  // actions that are due are therefore taken out of their components, and run
+  // once iteration is over.
+  dueActions_.clear();
+  finished_.clear();
 
-  for (id_type entity : entities)
-  {
-    auto& schedulable = game_.getEntityManager().
-      getComponent<SchedulableComponent>(entity);
+  game_.getEntityManager().each<SchedulableComponent>(
+    [&] (id_type entity, SchedulableComponent& schedulable) {
+      for (auto& action : schedulable.actions)
+      {
+        std::get<0>(action) -= dt;
 
-    for (auto& action : schedulable.actions)
-    {
-      std::get<0>(action) -= dt;
+        if (std::get<0>(action) < 0)
+        {
+          dueActions_.emplace_back(entity, std::move(std::get<1>(action)));
+        }
+      }
+
+      erase_if(schedulable.actions,
+        [] (const SchedulableComponent::Action& action) {
+          return (std::get<0>(action) < 0);
+        });
 
-      if (std::get<0>(action) < 0)
+      if (schedulable.actions.empty())
       {
-        std::get<1>(action)(entity);
+        finished_.push_back(entity);
       }
+    });
+
+  // An earlier action may have deleted the entity that a later one was for.
+  for (auto& action : dueActions_)
+  {
+    if (game_.getEntityManager().isValid(action.first))
+    {
+      action.second(action.first);
     }
+  }
+
+  dueActions_.clear();
 
-    erase_if(schedulable.actions,
-      [] (const SchedulableComponent::Action& action) {
-        return (std::get<0>(action) < 0);
-      });
+  // An action may have scheduled something new in the meantime, or removed
+  // the entity or its component, so check again.
+  for (id_type entity : finished_)
+  {
+    if (!game_.getEntityManager().isValid(entity) ||
+      !game_.getEntityManager().hasComponent<SchedulableComponent>(entity))
+    {
+      continue;
+    }
+
+    auto& schedulable = game_.getEntityManager().
+      getComponent<SchedulableComponent>(entity);
 
     if (schedulable.actions.empty())
     {
@@ -2,6 +2,9 @@
 #define SCHEDULING_H_7B02E3E3
 
 #include "system.h"
+#include <functional>
+#include <utility>
+#include <vector>
 
 class SchedulingSystem : public System {
 public:
@@ -10,6 +13,18 @@ public:
   {
   }
 
+  /**
+   * Scheduled actions can do anything, so this system never ticks alongside
+   * another one.
+   */
+  Access getAccess() const
+  {
+    Access access;
+    access.exclusive = true;
+
+    return access;
+  }
+
   void tick(double dt);
 
   void schedule(
@@ -17,6 +32,14 @@ public:
     double length,
     std::function<void(id_type)> action);
 
+private:
+
+  /**
+   * Scratch space for the actions that are due in a tick, and the entities
+   * with nothing left scheduled.
+   */
+  std::vector<std::pair<id_type, std::function<void(id_type)>>> dueActions_;
+  std::vector<id_type> finished_;
 };
 
 #endif /* end of include guard: SCHEDULING_H_7B02E3E3 */
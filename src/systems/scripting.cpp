@@ -8,6 +8,7 @@
 #include "components/prototypable.h"
 #include "components/automatable.h"
 #include "systems/realizing.h"
+#include "systems/pondering.h"
 #include "vector.h"
 #include "muxer.h"
 
@@ -108,6 +109,146 @@ ScriptingSystem::ScriptingSystem(Game& game) : System(game)
       return game_.getSystemManager().getSystem<RealizingSystem>();
     });
 
+  engine_.new_enum(
+    "collision",
+    "wall", PonderableComponent::Collision::wall,
+    "platform", PonderableComponent::Collision::platform,
+    "adjacency", PonderableComponent::Collision::adjacency,
+    "warp", PonderableComponent::Collision::warp,
+    "danger", PonderableComponent::Collision::danger,
+    "event", PonderableComponent::Collision::event);
+
+  engine_.new_enum(
+    "layer",
+    "body", PonderableComponent::Layer::body,
+    "player", PonderableComponent::Layer::player,
+    "platform", PonderableComponent::Layer::platform,
+    "trigger", PonderableComponent::Layer::trigger,
+    "all", PonderableComponent::Layer::all);
+
+  engine_.new_usertype<PonderingSystem::QueryHit>(
+    "queryHit",
+    "hit", sol::property(
+      [] (PonderingSystem::QueryHit& hit) { return hit.hit; }),
+    "time", sol::property(
+      [] (PonderingSystem::QueryHit& hit) { return hit.time; }),
+    "pos", sol::property(
+      [] (PonderingSystem::QueryHit& hit) { return hit.pos; }),
+    "collider", sol::property(
+      [] (PonderingSystem::QueryHit& hit) -> sol::optional<script_entity> {
+        if (!hit.hit)
+        {
+          return sol::nullopt;
+        }
+
+        return script_entity(hit.collider);
+      }),
+    "type", sol::property(
+      [] (PonderingSystem::QueryHit& hit) { return hit.type; }));
+
+  // Masks are optional, and default to every layer. The batched queries take
+  // a table of tables, with the same fields as the arguments to the single
+  // queries, and return a table with a hit for each.
+  using layer_type = PonderableComponent::layer_type;
+
+  engine_.new_usertype<PonderingSystem>(
+    "pondering",
+    "raycast", [] (
+      PonderingSystem& pondering,
+      vec2d from,
+      vec2d to,
+      sol::optional<layer_type> mask) {
+        return pondering.raycast(
+          from,
+          to,
+          mask.value_or(PonderableComponent::Layer::all));
+      },
+    "sweep", [] (
+      PonderingSystem& pondering,
+      vec2d pos,
+      vec2i size,
+      vec2d to,
+      sol::optional<layer_type> mask) {
+        return pondering.sweep(
+          pos,
+          size,
+          to,
+          mask.value_or(PonderableComponent::Layer::all));
+      },
+    "overlap", [] (
+      PonderingSystem& pondering,
+      vec2d pos,
+      vec2i size,
+      sol::optional<layer_type> mask) {
+        std::vector<id_type> colliders;
+
+        pondering.overlap(
+          pos,
+          size,
+          colliders,
+          mask.value_or(PonderableComponent::Layer::all));
+
+        return sol::as_table(
+          std::vector<script_entity>(
+            std::begin(colliders),
+            std::end(colliders)));
+      },
+    "raycastBatch", [] (
+      PonderingSystem& pondering,
+      sol::table queries,
+      sol::optional<layer_type> mask) {
+        std::vector<PonderingSystem::Ray> rays;
+
+        for (size_t i = 1; i <= queries.size(); i++)
+        {
+          sol::table query = queries.get<sol::table>(i);
+
+          rays.push_back({
+            query.get<vec2d>("from"),
+            query.get<vec2d>("to")});
+        }
+
+        std::vector<PonderingSystem::QueryHit> hits;
+
+        pondering.raycastBatch(
+          rays,
+          hits,
+          mask.value_or(PonderableComponent::Layer::all));
+
+        return sol::as_table(std::move(hits));
+      },
+    "sweepBatch", [] (
+      PonderingSystem& pondering,
+      sol::table queries,
+      sol::optional<layer_type> mask) {
+        std::vector<PonderingSystem::Sweep> sweeps;
+
+        for (size_t i = 1; i <= queries.size(); i++)
+        {
+          sol::table query = queries.get<sol::table>(i);
+
+          sweeps.push_back({
+            query.get<vec2d>("pos"),
+            query.get<vec2i>("size"),
+            query.get<vec2d>("to")});
+        }
+
+        std::vector<PonderingSystem::QueryHit> hits;
+
+        pondering.sweepBatch(
+          sweeps,
+          hits,
+          mask.value_or(PonderableComponent::Layer::all));
+
+        return sol::as_table(std::move(hits));
+      });
+
+  engine_.set_function(
+    "pondering",
+    [&] () -> PonderingSystem& {
+      return game_.getSystemManager().getSystem<PonderingSystem>();
+    });
+
   engine_.set_function("playSound", playSound);
 
   engine_.script_file("scripts/common.lua");
@@ -117,29 +258,23 @@ ScriptingSystem::ScriptingSystem(Game& game) : System(game)
 
 void ScriptingSystem::tick(double dt)
 {
-  auto entities = game_.getEntityManager().getEntitiesWithComponents<
-    RunnableComponent>();
-
-  for (id_type entity : entities)
-  {
-    auto& runnable = game_.getEntityManager().
-      getComponent<RunnableComponent>(entity);
-
-    if (*runnable.callable)
-    {
-      auto result = (*runnable.callable)(dt);
-      if (!result.valid())
+  game_.getEntityManager().each<RunnableComponent>(
+    [&] (id_type entity, RunnableComponent& runnable) {
+      if (*runnable.callable)
       {
-        sol::error e = result;
-        throw std::runtime_error(e.what());
+        auto result = (*runnable.callable)(dt);
+        if (!result.valid())
+        {
+          sol::error e = result;
+          throw std::runtime_error(e.what());
+        }
       }
-    }
 
-    if (!*runnable.callable)
-    {
-      killScript(entity);
-    }
-  }
+      if (!*runnable.callable)
+      {
+        killScript(entity);
+      }
+    });
 }
 
 void ScriptingSystem::killScript(id_type entity)
@@ -155,7 +290,9 @@ void ScriptingSystem::killScript(id_type entity)
     automatable.running = false;
   }
 
-  game_.getEntityManager().deleteEntity(entity);
+  // Scripts are killed from within entity loops (including this system's own
+  // tick), so the deletion is deferred until the next sync point.
+  game_.getEntityManager().deferDeleteEntity(entity);
 }
 
 template <typename... Args>
@@ -238,7 +375,10 @@ void ScriptingSystem::stopBehavior(id_type entity)
   auto& automatable = game_.getEntityManager().
     getComponent<AutomatableComponent>(entity);
 
-  if (automatable.running)
+  // The handle check guards against the script entity having been deleted and
+  // its slot reused by an unrelated entity.
+  if (automatable.running &&
+    game_.getEntityManager().isValid(automatable.script))
   {
     killScript(automatable.script);
   }
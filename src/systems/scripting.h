@@ -9,6 +9,18 @@ public:
 
   ScriptingSystem(Game& game);
 
+  /**
+   * Scripts can do anything, so this system never ticks alongside another
+   * one.
+   */
+  Access getAccess() const
+  {
+    Access access;
+    access.exclusive = true;
+
+    return access;
+  }
+
   void tick(double dt);
 
   void killScript(id_type entity);
@@ -0,0 +1,164 @@
+#ifndef TILE_COLLISION_GRID_H_71C5D2B8
+#define TILE_COLLISION_GRID_H_71C5D2B8
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include "components/ponderable.h"
+#include "direction.h"
+#include "consts.h"
+
+/**
+ * The collision boundaries of a map, stored per tile rather than as lists, so
+ * that a sweep can step through the tiles it crosses.
+ *
+ * A face of a tile is identified by the direction of movement that it blocks;
+ * for instance, the left face of a tile is the one that blocks movement to the
+ * right. Each tile has at most one face per direction. The boundaries at the
+ * edges of the map, which lie outside of the tile grid, are stored separately.
+ *
+ * Faces that are hidden by a neighboring tile are left out, so the grid also
+ * records which tiles are solid, for telling whether a box is inside a wall.
+ */
+class TileCollisionGrid {
+public:
+
+  using Type = PonderableComponent::Collision;
+
+  struct Edge {
+    double axis = 0.0;
+    double lower = 0.0;
+    double upper = 0.0;
+    Type type = Type::adjacency;
+    bool present = false;
+  };
+
+  TileCollisionGrid()
+  {
+    for (std::vector<uint8_t>& faces : faces_)
+    {
+      faces.resize(MAP_WIDTH * MAP_HEIGHT, NO_FACE);
+    }
+
+    solids_.resize(MAP_WIDTH * MAP_HEIGHT, NO_FACE);
+  }
+
+  /**
+   * Marks a tile as blocking bodies throughout, rather than only at its faces.
+   */
+  inline void setSolid(int x, int y, Type type)
+  {
+    solids_[x + y * MAP_WIDTH] = static_cast<uint8_t>(type);
+  }
+
+  inline bool isSolid(int x, int y) const
+  {
+    return solids_[x + y * MAP_WIDTH] != NO_FACE;
+  }
+
+  /**
+   * @requires isSolid(x, y)
+   */
+  inline Type getSolid(int x, int y) const
+  {
+    return static_cast<Type>(solids_[x + y * MAP_WIDTH]);
+  }
+
+  inline void setFace(Direction dir, int x, int y, Type type)
+  {
+    faces_[static_cast<size_t>(dir)][x + y * MAP_WIDTH] =
+      static_cast<uint8_t>(type);
+  }
+
+  inline bool hasFace(Direction dir, int x, int y) const
+  {
+    return faces_[static_cast<size_t>(dir)][x + y * MAP_WIDTH] != NO_FACE;
+  }
+
+  /**
+   * @requires hasFace(dir, x, y)
+   */
+  inline Type getFace(Direction dir, int x, int y) const
+  {
+    return static_cast<Type>(
+      faces_[static_cast<size_t>(dir)][x + y * MAP_WIDTH]);
+  }
+
+  /**
+   * Returns the position of a tile's face on the axis of movement.
+   */
+  static inline double getFaceAxis(Direction dir, int x, int y, Type type)
+  {
+    switch (dir)
+    {
+      case Direction::left: return (x + 1) * TILE_WIDTH;
+      case Direction::right: return x * TILE_WIDTH;
+      case Direction::up: return (y + 1) * TILE_HEIGHT;
+      case Direction::down:
+      {
+        // The top of a danger tile is one pixel lower than the top of the tile.
+        if (type == Type::danger)
+        {
+          return y * TILE_HEIGHT + 1;
+        } else {
+          return y * TILE_HEIGHT;
+        }
+      }
+    }
+
+    return 0.0;
+  }
+
+  /**
+   * Returns the extent of a tile's face on the axis perpendicular to movement.
+   * The faces of neighboring tiles share their endpoints, as the merged
+   * boundary runs do, and a ray that has no extent only hits the range
+   * [lower, upper).
+   */
+  static inline void getFaceRange(
+    Direction dir,
+    int x,
+    int y,
+    double& lower,
+    double& upper)
+  {
+    if ((dir == Direction::left) || (dir == Direction::right))
+    {
+      lower = y * TILE_HEIGHT;
+      upper = (y + 1) * TILE_HEIGHT;
+    } else {
+      lower = x * TILE_WIDTH;
+      upper = (x + 1) * TILE_WIDTH;
+    }
+  }
+
+  inline void setEdge(
+    Direction dir,
+    double axis,
+    double lower,
+    double upper,
+    Type type)
+  {
+    Edge& edge = edges_[static_cast<size_t>(dir)];
+    edge.axis = axis;
+    edge.lower = lower;
+    edge.upper = upper;
+    edge.type = type;
+    edge.present = true;
+  }
+
+  inline const Edge& getEdge(Direction dir) const
+  {
+    return edges_[static_cast<size_t>(dir)];
+  }
+
+private:
+
+  static constexpr uint8_t NO_FACE = 0xFF;
+
+  std::array<std::vector<uint8_t>, 4> faces_;
+  std::vector<uint8_t> solids_;
+  std::array<Edge, 4> edges_;
+};
+
+#endif /* end of include guard: TILE_COLLISION_GRID_H_71C5D2B8 */
@@ -0,0 +1,32 @@
+#ifndef TYPE_FAMILY_H_5E20B7D1
+#define TYPE_FAMILY_H_5E20B7D1
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Assigns a small, dense integer ID to each type within a family (for
+ * instance, all component types). The ID of a type is fixed the first time it
+ * is requested and can be used to index directly into arrays, avoiding RTTI
+ * lookups on hot paths.
+ */
+template <class Family>
+class TypeFamily {
+public:
+
+  using id_type = size_t;
+
+  template <class T>
+  static id_type getId()
+  {
+    static const id_type id = nextId_++;
+
+    return id;
+  }
+
+private:
+
+  static inline std::atomic<id_type> nextId_ {0};
+};
+
+#endif /* end of include guard: TYPE_FAMILY_H_5E20B7D1 */
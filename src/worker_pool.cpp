@@ -0,0 +1,110 @@
+#include "worker_pool.h"
+
+WorkerPool::WorkerPool(size_t numWorkers)
+{
+  for (size_t i = 0; i < numWorkers; i++)
+  {
+    workers_.emplace_back(&WorkerPool::work, this);
+  }
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+
+  taskAvailable_.notify_all();
+
+  for (std::thread& worker : workers_)
+  {
+    worker.join();
+  }
+}
+
+void WorkerPool::run(std::vector<task_type> tasks)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  for (task_type& task : tasks)
+  {
+    queue_.push_back(std::move(task));
+  }
+
+  remaining_ += tasks.size();
+  taskAvailable_.notify_all();
+
+  // Help out with the batch instead of idling.
+  while (runOne(lock))
+  {
+  }
+
+  batchDone_.wait(lock, [this] () { return remaining_ == 0; });
+
+  if (error_)
+  {
+    std::exception_ptr error = error_;
+    error_ = nullptr;
+
+    std::rethrow_exception(error);
+  }
+}
+
+void WorkerPool::work()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  for (;;)
+  {
+    taskAvailable_.wait(lock, [this] () {
+      return stopping_ || !queue_.empty();
+    });
+
+    if (stopping_)
+    {
+      return;
+    }
+
+    runOne(lock);
+  }
+}
+
+bool WorkerPool::runOne(std::unique_lock<std::mutex>& lock)
+{
+  if (queue_.empty())
+  {
+    return false;
+  }
+
+  task_type task = std::move(queue_.front());
+  queue_.pop_front();
+
+  lock.unlock();
+
+  std::exception_ptr error;
+
+  try
+  {
+    task();
+  } catch (...)
+  {
+    error = std::current_exception();
+  }
+
+  lock.lock();
+
+  if (error && !error_)
+  {
+    error_ = error;
+  }
+
+  remaining_--;
+
+  if (remaining_ == 0)
+  {
+    batchDone_.notify_all();
+  }
+
+  return true;
+}
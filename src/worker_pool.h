@@ -0,0 +1,60 @@
+#ifndef WORKER_POOL_H_2B64E8A7
+#define WORKER_POOL_H_2B64E8A7
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+/**
+ * A fixed set of worker threads that run batches of tasks. The calling thread
+ * also works on the batch, and run() does not return until every task in the
+ * batch has finished.
+ */
+class WorkerPool {
+public:
+
+  using task_type = std::function<void()>;
+
+  /**
+   * Starts the given number of worker threads, in addition to the thread that
+   * calls run().
+   */
+  explicit WorkerPool(size_t numWorkers);
+
+  WorkerPool(const WorkerPool& other) = delete;
+  WorkerPool& operator=(const WorkerPool& other) = delete;
+
+  ~WorkerPool();
+
+  /**
+   * Runs the tasks concurrently and waits for them to complete. If any task
+   * throws, the first exception is rethrown once the whole batch is done.
+   */
+  void run(std::vector<task_type> tasks);
+
+  inline size_t getNumWorkers() const
+  {
+    return workers_.size();
+  }
+
+private:
+
+  void work();
+
+  bool runOne(std::unique_lock<std::mutex>& lock);
+
+  std::vector<std::thread> workers_;
+  std::deque<task_type> queue_;
+  std::mutex mutex_;
+  std::condition_variable taskAvailable_;
+  std::condition_variable batchDone_;
+  size_t remaining_ = 0;
+  std::exception_ptr error_;
+  bool stopping_ = false;
+};
+
+#endif /* end of include guard: WORKER_POOL_H_2B64E8A7 */
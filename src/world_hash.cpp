@@ -0,0 +1,159 @@
+#include "world_hash.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include "components/transformable.h"
+#include "components/ponderable.h"
+#include "components/animatable.h"
+#include "components/schedulable.h"
+
+/**
+ * The splitmix64 finalizer, which spreads every input bit over the output.
+ */
+inline uint64_t mixBits(uint64_t value)
+{
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ULL;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebULL;
+  value ^= value >> 31;
+
+  return value;
+}
+
+inline void hashBits(uint64_t& hash, uint64_t bits)
+{
+  hash = mixBits(hash ^ bits) + 0x9e3779b97f4a7c15ULL;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value>::type hashValue(
+  uint64_t& hash,
+  T value)
+{
+  hashBits(hash, static_cast<uint64_t>(value));
+}
+
+inline void hashValue(uint64_t& hash, double value)
+{
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  hashBits(hash, bits);
+}
+
+inline void hashValue(uint64_t& hash, const std::string& value)
+{
+  hashValue(hash, value.size());
+
+  // Pack the string eight bytes at a time.
+  for (size_t i = 0; i < value.size(); i += sizeof(uint64_t))
+  {
+    uint64_t chunk = 0;
+    std::memcpy(
+      &chunk,
+      value.data() + i,
+      std::min(sizeof(uint64_t), value.size() - i));
+
+    hashBits(hash, chunk);
+  }
+}
+
+template <typename T>
+inline void hashValue(uint64_t& hash, const vec2<T>& value)
+{
+  hashValue(hash, value.x());
+  hashValue(hash, value.y());
+}
+
+uint64_t WorldHash::combined() const
+{
+  uint64_t hash = 0;
+  hashBits(hash, transformable);
+  hashBits(hash, ponderable);
+  hashBits(hash, animatable);
+  hashBits(hash, schedulable);
+
+  return hash;
+}
+
+WorldHash hashWorld(EntityManager& entityManager)
+{
+  using id_type = EntityManager::id_type;
+
+  WorldHash result;
+
+  entityManager.each<TransformableComponent>([&] (
+    id_type entity,
+    TransformableComponent& transformable) {
+      uint64_t hash = entity;
+      hashValue(hash, transformable.pos);
+      hashValue(hash, transformable.size);
+
+      result.transformable += mixBits(hash);
+    });
+
+  entityManager.each<PonderableComponent>([&] (
+    id_type entity,
+    PonderableComponent& ponderable) {
+      uint64_t hash = entity;
+      hashValue(hash, ponderable.vel);
+      hashValue(hash, ponderable.accel);
+      hashValue(hash, ponderable.targetVel);
+      hashValue(hash, ponderable.grounded);
+      hashValue(hash, ponderable.ferried);
+      hashValue(hash, ponderable.frozen);
+      hashValue(hash, ponderable.collidable);
+      hashValue(hash, ponderable.layer);
+      hashValue(hash, ponderable.mask);
+      hashValue(hash, ponderable.active);
+      hashValue(hash, ponderable.asleep);
+
+      if (ponderable.ferried)
+      {
+        hashValue(hash, ponderable.ferry);
+        hashValue(hash, static_cast<int>(ponderable.ferrySide));
+      }
+
+      for (id_type passenger : ponderable.passengers)
+      {
+        hashValue(hash, passenger);
+      }
+
+      result.ponderable += mixBits(hash);
+    });
+
+  entityManager.each<AnimatableComponent>([&] (
+    id_type entity,
+    AnimatableComponent& animatable) {
+      uint64_t hash = entity;
+      hashValue(hash, animatable.animation);
+      hashValue(hash, animatable.frame);
+      hashValue(hash, animatable.countdown);
+      hashValue(hash, animatable.flickering);
+      hashValue(hash, animatable.flickerTimer);
+      hashValue(hash, animatable.frozen);
+      hashValue(hash, animatable.active);
+
+      result.animatable += mixBits(hash);
+    });
+
+  // Scheduled callbacks can't be compared, but the times remaining until they
+  // fire can.
+  entityManager.each<SchedulableComponent>([&] (
+    id_type entity,
+    SchedulableComponent& schedulable) {
+      uint64_t hash = entity;
+      hashValue(hash, schedulable.actions.size());
+
+      for (const SchedulableComponent::Action& action : schedulable.actions)
+      {
+        hashValue(hash, std::get<0>(action));
+      }
+
+      result.schedulable += mixBits(hash);
+    });
+
+  return result;
+}
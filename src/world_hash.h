@@ -0,0 +1,28 @@
+#ifndef WORLD_HASH_H_2E7B4C90
+#define WORLD_HASH_H_2E7B4C90
+
+#include <cstdint>
+#include "entity_manager.h"
+
+/**
+ * A checksum of the simulation state, used to check that two runs (usually a
+ * replay on two different builds) stay in lockstep. Each component type is
+ * hashed separately, so that when runs diverge it is clear where.
+ *
+ * Floating point values are hashed by their bit patterns, so any difference at
+ * all, including between 0.0 and -0.0, changes the hash. Entities are hashed
+ * independently and then summed, so the hash does not depend on the order
+ * that components are stored in, but it does depend on entity handles.
+ */
+struct WorldHash {
+  uint64_t transformable = 0;
+  uint64_t ponderable = 0;
+  uint64_t animatable = 0;
+  uint64_t schedulable = 0;
+
+  uint64_t combined() const;
+};
+
+WorldHash hashWorld(EntityManager& entityManager);
+
+#endif /* end of include guard: WORLD_HASH_H_2E7B4C90 */
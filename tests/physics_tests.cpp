@@ -0,0 +1,287 @@
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "game.h"
+#include "consts.h"
+#include "components/mappable.h"
+#include "components/ponderable.h"
+#include "components/transformable.h"
+#include "systems/mapping.h"
+#include "systems/pondering.h"
+#include "systems/realizing.h"
+
+/**
+ * Regression checks for the physics, run against small hand-built maps. Each
+ * check prints a line if it fails, and the program exits with the number of
+ * failures.
+ */
+
+using id_type = EntityManager::id_type;
+
+const int WALL_TILE = 1;
+
+static int failures = 0;
+
+void check(bool condition, const std::string& name)
+{
+  if (!condition)
+  {
+    std::cerr << "FAILED: " << name << std::endl;
+    failures++;
+  }
+}
+
+/**
+ * Creates a map with the given tiles, and makes it the active map.
+ */
+id_type createMap(Game& game, const std::vector<int>& tiles)
+{
+  EntityManager& entityManager = game.getEntityManager();
+
+  id_type map = entityManager.emplaceEntity();
+
+  auto& mappable = entityManager.emplaceComponent<MappableComponent>(map,
+    Texture("res/tiles.png"),
+    Texture("res/font.bmp"));
+
+  mappable.title = "Physics tests";
+  mappable.tiles = tiles;
+
+  game.getSystemManager().getSystem<MappingSystem>().generateBoundaries(map);
+  game.getSystemManager().getSystem<RealizingSystem>().loadMap(map);
+
+  return map;
+}
+
+/**
+ * Returns a map that is empty apart from a floor of walls running from
+ * firstColumn to lastColumn on the given row.
+ */
+std::vector<int> makeFloor(int firstColumn, int lastColumn, int row)
+{
+  std::vector<int> tiles(MAP_WIDTH * MAP_HEIGHT, 0);
+
+  for (int x = firstColumn; x <= lastColumn; x++)
+  {
+    tiles[x + row * MAP_WIDTH] = WALL_TILE;
+  }
+
+  return tiles;
+}
+
+id_type createBody(
+  Game& game,
+  PonderableComponent::Type type,
+  vec2d pos,
+  vec2i size)
+{
+  EntityManager& entityManager = game.getEntityManager();
+
+  id_type entity = entityManager.emplaceEntity();
+
+  auto& transformable = entityManager.
+    emplaceComponent<TransformableComponent>(entity);
+
+  transformable.pos = pos;
+  transformable.size = size;
+  transformable.origPos = pos;
+  transformable.origSize = size;
+
+  auto& pondering = game.getSystemManager().getSystem<PonderingSystem>();
+  pondering.initializeBody(entity, type);
+
+  game.getSystemManager().getSystem<RealizingSystem>().enterActiveMap(entity);
+  pondering.refreshBody(entity);
+
+  return entity;
+}
+
+/**
+ * A ray cast straight down the seam between two floor tiles has to hit the
+ * floor with either backend, even though one of them sees the floor as a
+ * single merged boundary and the other as separate tiles.
+ */
+void testRaycastOnTileSeam(Game& game)
+{
+  const int FLOOR_ROW = 20;
+
+  id_type map = createMap(game, makeFloor(5, 10, FLOOR_ROW));
+  auto& pondering = game.getSystemManager().getSystem<PonderingSystem>();
+
+  // Only the map should be hit, wherever the player happens to be.
+  PonderableComponent::layer_type mask =
+    ~PonderableComponent::Layer::player;
+
+  for (PonderingSystem::EnvironmentBackend backend : {
+    PonderingSystem::EnvironmentBackend::boundaries,
+    PonderingSystem::EnvironmentBackend::tiles })
+  {
+    pondering.setEnvironmentBackend(backend);
+
+    // The left end of the floor, a seam in the middle, and the start of the
+    // last tile all lie within the floor.
+    for (int column : { 5, 6, 10 })
+    {
+      double x = column * TILE_WIDTH;
+
+      PonderingSystem::QueryHit hit = pondering.raycast(
+        { x, 0.0 },
+        { x, (FLOOR_ROW + 2.0) * TILE_HEIGHT },
+        mask);
+
+      std::string name = "raycast down column " + std::to_string(column) +
+        " hits the floor (" +
+        PonderingSystem::getEnvironmentBackendName(backend) + ")";
+
+      check(hit.hit, name);
+      check(hit.collider == map, name + ": collider");
+      check(
+        std::abs(hit.pos.y() - FLOOR_ROW * TILE_HEIGHT) < 1e-9,
+        name + ": position");
+    }
+
+    // The right end of the floor is where the next tile would start.
+    double x = 11 * TILE_WIDTH;
+
+    PonderingSystem::QueryHit hit = pondering.raycast(
+      { x, 0.0 },
+      { x, (FLOOR_ROW + 2.0) * TILE_HEIGHT },
+      mask);
+
+    check(
+      !hit.hit,
+      "raycast past the right end of the floor misses (" +
+        PonderingSystem::getEnvironmentBackendName(backend) + ")");
+  }
+
+  pondering.setEnvironmentBackend(
+    PonderingSystem::EnvironmentBackend::boundaries);
+}
+
+/**
+ * A diagonal ray that reaches the floor exactly on the seam between two tiles
+ * has to hit it too. The tiles backend only looks at the tiles that the ray
+ * passes through, and the seam is the far end of the stretch of floor that it
+ * passes over.
+ */
+void testDiagonalRaycastOnTileSeam(Game& game)
+{
+  const int FLOOR_ROW = 20;
+
+  id_type map = createMap(game, makeFloor(5, 10, FLOOR_ROW));
+  auto& pondering = game.getSystemManager().getSystem<PonderingSystem>();
+
+  PonderableComponent::layer_type mask =
+    ~PonderableComponent::Layer::player;
+
+  for (PonderingSystem::EnvironmentBackend backend : {
+    PonderingSystem::EnvironmentBackend::boundaries,
+    PonderingSystem::EnvironmentBackend::tiles })
+  {
+    pondering.setEnvironmentBackend(backend);
+
+    // The ray moves down and to the left at 45 degrees, and reaches the top
+    // of the floor at the left edge of column 6.
+    double seamX = 6 * TILE_WIDTH;
+    double floorY = FLOOR_ROW * TILE_HEIGHT;
+
+    PonderingSystem::QueryHit hit = pondering.raycast(
+      { seamX + 12.0, floorY - 12.0 },
+      { seamX - 12.0, floorY + 12.0 },
+      mask);
+
+    std::string name = "diagonal raycast onto a seam hits the floor (" +
+      PonderingSystem::getEnvironmentBackendName(backend) + ")";
+
+    check(hit.hit, name);
+    check(hit.collider == map, name + ": collider");
+    check(
+      (std::abs(hit.pos.x() - seamX) < 1e-9) &&
+        (std::abs(hit.pos.y() - floorY) < 1e-9),
+      name + ": position");
+  }
+
+  pondering.setEnvironmentBackend(
+    PonderingSystem::EnvironmentBackend::boundaries);
+}
+
+/**
+ * A body that walks off the end of a ledge has to start falling in the tick
+ * that it leaves the ledge, just as it did when the axes were always swept
+ * horizontally first.
+ */
+void testWalkingOffLedge(Game& game)
+{
+  const int FLOOR_ROW = 20;
+  const int BODY_SIZE = 6;
+  const double DT = 0.01;
+
+  createMap(game, makeFloor(5, 10, FLOOR_ROW));
+
+  EntityManager& entityManager = game.getEntityManager();
+  auto& pondering = game.getSystemManager().getSystem<PonderingSystem>();
+
+  for (PonderingSystem::EnvironmentBackend backend : {
+    PonderingSystem::EnvironmentBackend::boundaries,
+    PonderingSystem::EnvironmentBackend::tiles })
+  {
+    pondering.setEnvironmentBackend(backend);
+
+    // The body overlaps the last floor tile by a pixel, and walks one pixel
+    // to the right per tick.
+    double startY = FLOOR_ROW * TILE_HEIGHT - BODY_SIZE;
+
+    id_type body = createBody(
+      game,
+      PonderableComponent::Type::freefalling,
+      { 11.0 * TILE_WIDTH - 1.0, startY },
+      { BODY_SIZE, BODY_SIZE });
+
+    auto& ponderable = entityManager.getComponent<PonderableComponent>(body);
+    ponderable.grounded = true;
+    ponderable.vel.x() = 1.0 / DT;
+    ponderable.targetVel.x() = 1.0 / DT;
+
+    pondering.tick(DT);
+    entityManager.flushCommands();
+
+    auto& transformable =
+      entityManager.getComponent<TransformableComponent>(body);
+
+    std::string name = "walking off a ledge (" +
+      PonderingSystem::getEnvironmentBackendName(backend) + ")";
+
+    check(
+      std::abs(transformable.pos.x() - 11.0 * TILE_WIDTH) < 1e-9,
+      name + ": walks off");
+    check(
+      !entityManager.getComponent<PonderableComponent>(body).grounded,
+      name + ": not grounded");
+    check(transformable.pos.y() > startY, name + ": falls");
+
+    entityManager.deleteEntity(body);
+  }
+
+  pondering.setEnvironmentBackend(
+    PonderingSystem::EnvironmentBackend::boundaries);
+}
+
+int main()
+{
+  std::mt19937 rng(0);
+
+  Game game(rng);
+
+  testRaycastOnTileSeam(game);
+  testDiagonalRaycastOnTileSeam(game);
+  testWalkingOffLedge(game);
+
+  if (failures == 0)
+  {
+    std::cout << "All physics tests passed" << std::endl;
+  }
+
+  return failures;
+}